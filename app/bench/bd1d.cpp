@@ -0,0 +1,83 @@
+#include "bd1d.h"
+#include <bits/stdc++.h>
+
+// Carga fechada contra o bd1d: cada thread mantém uma conexão e envia
+// consultas uma atrás da outra. Mede a latência vista pelo cliente.
+int main(int argc, char* argv[]) {
+  if (argc < 4 || argc > 6) {
+    std::cerr << "Uso: " << argv[0] << " <socket> <concorrência> <consultas> [findrec|seek1|seek2] [id_máximo]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string socketPath = argv[1];
+  int concurrency = std::stoi(argv[2]);
+  int queries = std::stoi(argv[3]);
+  std::string command = argc > 4 ? argv[4] : "findrec";
+  int maxId = argc > 5 ? std::stoi(argv[5]) : 1000000;
+
+  std::cout << "=== bench_bd1d " << command << " concorrência=" << concurrency << " consultas=" << queries
+            << " ===" << std::endl;
+
+  std::vector<std::vector<int64_t>> latencies(concurrency);
+  std::atomic<int> failures(0);
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int c = 0; c < concurrency; c++) {
+    threads.emplace_back([&, c] {
+      Bd1Client client;
+      if (!client.connect(socketPath)) {
+        failures++;
+        return;
+      }
+
+      std::mt19937 rng(c + 1);
+      std::uniform_int_distribution<int> ids(1, maxId);
+      int status;
+      IoCounters counters;
+      std::string output;
+
+      for (int q = c; q < queries; q += concurrency) {
+        std::string request = command + " ";
+        if (command == "seek2")
+          request += std::string(1, 'A' + rng() % 26);
+        else
+          request += std::to_string(ids(rng));
+
+        auto q0 = std::chrono::steady_clock::now();
+        if (!client.query(request, status, counters, output)) {
+          failures++;
+          return;
+        }
+        auto q1 = std::chrono::steady_clock::now();
+        latencies[c].push_back(std::chrono::duration_cast<std::chrono::microseconds>(q1 - q0).count());
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  if (failures) {
+    std::cerr << "Erro: " << failures << " conexões falharam" << std::endl;
+    return 1;
+  }
+
+  std::vector<int64_t> all;
+  for (auto& l : latencies)
+    all.insert(all.end(), l.begin(), l.end());
+  std::sort(all.begin(), all.end());
+
+  auto percentile = [&](double p) {
+    return all.empty() ? 0 : all[std::min(all.size() - 1, (size_t) (p * all.size()))];
+  };
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << " " << all.size() / seconds << " consultas/s" << std::endl;
+  std::cout << " p50 " << percentile(0.50) << " µs, p99 " << percentile(0.99) << " µs, máx "
+            << (all.empty() ? 0 : all.back()) << " µs" << std::endl;
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "csv.h"
+#include "record.h"
+#include <bits/stdc++.h>
+
+// parse/trim originais do upload, mantidos aqui como referência.
+std::string legacyTrim(std::string& field) {
+  std::string trimmed = field;
+  trimmed.erase(trimmed.begin(), find_if(trimmed.begin(), trimmed.end(), [](char c) { return !isspace(c); }));
+  trimmed.erase(find_if(trimmed.rbegin(), trimmed.rend(), [](char c) { return !isspace(c); }).base(), trimmed.end());
+  return trimmed;
+}
+
+std::vector<std::string> legacyParse(std::string& line) {
+  std::vector<std::string> fields;
+  std::string field;
+  bool inQuotes = false;
+
+  for (char c : line) {
+    if (c == '"') {
+      inQuotes = !inQuotes;
+    } else if (c == ';' && !inQuotes) {
+      fields.push_back(legacyTrim(field));
+      field.clear();
+    } else {
+      field += c;
+    }
+  }
+
+  fields.push_back(legacyTrim(field));
+  return fields;
+}
+
+template <typename Fields>
+bool makeRecord(Fields& fields) {
+  try {
+    Record rec(fields);
+    return rec.id != 0;
+  } catch (const std::exception& e) {
+    return false;
+  }
+}
+
+double mbPerSec(size_t bytes, std::chrono::steady_clock::time_point t0) {
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return bytes / seconds / (1 << 20);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "Uso: " << argv[0] << " <arquivo_csv>" << std::endl;
+    return 1;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (!in && data.empty()) {
+    std::cerr << "Erro: não foi possível ler " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::cout << "=== bench_csv " << argv[1] << " (" << data.size() / (1 << 20) << " MB) ===" << std::endl;
+
+  std::vector<std::vector<std::string>> expected;
+  size_t legacyRecords = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    std::istringstream lines(data);
+    for (std::string line; getline(lines, line);) {
+      std::vector<std::string> fields = legacyParse(line);
+      if (expected.size() < 10000)
+        expected.push_back(fields);
+      fields.resize(std::max<size_t>(fields.size(), 7));
+      legacyRecords += makeRecord(fields);
+    }
+  }
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "     parse + Record: " << mbPerSec(data.size(), t0) << " MB/s" << std::endl;
+
+  std::vector<std::pair<const char*, CsvMaskFn>> kernels = {{"escalar", csvMaskScalar}, {"SSE2", csvMaskSSE2}};
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"AVX2", csvMaskAVX2});
+
+  for (auto& kernel : kernels) {
+    CsvTokenizer tokenizer(kernel.second);
+
+    std::string buffer = data;
+    size_t rows = 0, mismatches = 0;
+    tokenizer.tokenize(&buffer[0], buffer.size(), true, [&](const CsvRow& row) {
+      if (rows < expected.size()) {
+        const auto& fields = expected[rows];
+        if ((int) fields.size() != row.count)
+          mismatches++;
+        for (int i = 0; i < row.count && i < CSV_MAX_FIELDS && i < (int) fields.size(); i++)
+          mismatches += fields[i] != row.fields[i];
+      }
+      rows++;
+    });
+    if (mismatches) {
+      std::cerr << "Erro: tokenizador " << kernel.first << " divergiu do parse em " << mismatches << " campos"
+                << std::endl;
+      return 1;
+    }
+
+    buffer = data;
+    size_t fieldCount = 0;
+    t0 = std::chrono::steady_clock::now();
+    tokenizer.tokenize(&buffer[0], buffer.size(), true, [&](const CsvRow& row) { fieldCount += row.count; });
+    double tokenRate = mbPerSec(data.size(), t0);
+
+    buffer = data;
+    size_t records = 0;
+    t0 = std::chrono::steady_clock::now();
+    tokenizer.tokenize(&buffer[0], buffer.size(), true, [&](const CsvRow& row) {
+      std::string_view fields[7];
+      for (int i = 0; i < 7 && i < row.count; i++)
+        fields[i] = row.fields[i];
+      records += makeRecord(fields);
+    });
+    double recordRate = mbPerSec(data.size(), t0);
+
+    std::cout << std::setw(11) << kernel.first << " tokens: " << tokenRate << " MB/s, + Record: " << recordRate
+              << " MB/s" << std::endl;
+
+    if (records != legacyRecords) {
+      std::cerr << "Erro: " << records << " registros, esperado " << legacyRecords << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
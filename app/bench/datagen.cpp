@@ -0,0 +1,36 @@
+#include "datagen.h"
+#include <bits/stdc++.h>
+
+// Escreve em stdout n linhas sintéticas no formato do artigo.csv, com ids
+// de 1 a n. A mesma semente gera sempre o mesmo arquivo.
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Uso: " << argv[0] << " <registros> [semente] > artigo.csv" << std::endl;
+    return 1;
+  }
+
+  int64_t n;
+  uint64_t seed = 1;
+  try {
+    n = std::stoll(argv[1]);
+    if (argc > 2)
+      seed = std::stoull(argv[2]);
+    if (n < 0)
+      throw std::exception();
+  } catch (const std::exception& e) {
+    std::cerr << "Erro: argumento inválido" << std::endl;
+    return 1;
+  }
+
+  ArticleGenerator generator(seed);
+  std::string buffer;
+  for (int64_t i = 0; i < n; i++) {
+    generator.nextLine(buffer);
+    if (buffer.size() >= (1 << 20)) {
+      fwrite(buffer.data(), 1, buffer.size(), stdout);
+      buffer.clear();
+    }
+  }
+  fwrite(buffer.data(), 1, buffer.size(), stdout);
+  return fflush(stdout) == 0 ? 0 : 1;
+}
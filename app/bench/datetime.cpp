@@ -0,0 +1,88 @@
+#include "record.h"
+#include <bits/stdc++.h>
+
+// Versões originais (get_time + mktime, localtime + strftime), mantidas
+// como referência. Com TZ=UTC devem concordar com as novas.
+time_t legacyParseDateTime(const std::string& datetime_str) {
+  struct tm tm = {};
+  std::istringstream ss(datetime_str);
+  ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+  return mktime(&tm);
+}
+
+std::string legacyFormatDateTime(time_t timestamp) {
+  char buffer[32];
+  struct tm* tm_info = localtime(&timestamp);
+  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", tm_info);
+  return std::string(buffer);
+}
+
+double perSec(size_t n, std::chrono::steady_clock::time_point t0) {
+  return n / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+  int n = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+  setenv("TZ", "UTC", 1);
+  tzset();
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> instant(-2208988800LL, 4102444799LL);
+  std::vector<std::string> samples;
+
+  int mismatches = 0;
+  for (int i = 0; i < n; i++) {
+    time_t t = instant(rng);
+    std::string legacy = legacyFormatDateTime(t);
+    std::string fast = formatDateTime(t);
+    mismatches += legacy != fast;
+    mismatches += parseDateTime(fast) != t;
+    samples.push_back(fast);
+
+    char fuzz[32];
+    snprintf(fuzz, sizeof(fuzz), "%04d-%02d-%02d %02d:%02d:%02d", (int) (rng() % 300) + 1850, (int) (rng() % 12) + 1,
+             (int) (rng() % 31) + 1, (int) (rng() % 24), (int) (rng() % 60), (int) (rng() % 61));
+    if (parseDateTime(fuzz) != legacyParseDateTime(fuzz)) {
+      if (mismatches++ < 5)
+        std::cerr << "divergência em \"" << fuzz << "\"" << std::endl;
+    }
+  }
+
+  std::cout << "=== bench_datetime n=" << n << " ===" << std::endl;
+  if (mismatches) {
+    std::cerr << "Erro: " << mismatches << " divergências em relação às funções originais" << std::endl;
+    return 1;
+  }
+  std::cout << " " << 2 * n << " datas conferidas com get_time/mktime e strftime (TZ=UTC)" << std::endl;
+
+  int64_t checksum = 0;
+  std::cout << std::fixed << std::setprecision(1);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (const auto& s : samples)
+    checksum += legacyParseDateTime(s);
+  std::cout << "    parse get_time+mktime: " << perSec(n, t0) / 1e6 << " M/s" << std::endl;
+
+  t0 = std::chrono::steady_clock::now();
+  for (const auto& s : samples)
+    checksum -= parseDateTime(s);
+  std::cout << "    parseDateTime:         " << perSec(n, t0) / 1e6 << " M/s" << std::endl;
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++)
+    checksum += legacyFormatDateTime(i * 4099LL).size();
+  std::cout << "   format localtime+strftime: " << perSec(n, t0) / 1e6 << " M/s" << std::endl;
+
+  char buffer[20];
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    formatDateTime(i * 4099LL, buffer);
+    checksum -= buffer[18];
+  }
+  std::cout << "   formatDateTime:            " << perSec(n, t0) / 1e6 << " M/s" << std::endl;
+
+  volatile int64_t sink = checksum;
+  (void) sink;
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "b+tree.h"
+#include <bits/stdc++.h>
+
+double benchInsert(const std::vector<int>& keys, int m) {
+  BPlusTree<int> tree(m);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int key : keys)
+    tree.insert(key);
+  auto t1 = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < keys.size(); i += keys.size() / 100 + 1)
+    if (!tree.search(keys[i])) {
+      std::cerr << "Erro: chave " << keys[i] << " não encontrada" << std::endl;
+      exit(1);
+    }
+
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / keys.size();
+}
+
+int main(int argc, char* argv[]) {
+  int n = argc > 1 ? std::stoi(argv[1]) : 1000000;
+  int m = argc > 2 ? std::stoi(argv[2]) : 170;
+
+  std::vector<int> sequential(n);
+  std::iota(sequential.begin(), sequential.end(), 1);
+
+  std::vector<int> random = sequential;
+  std::shuffle(random.begin(), random.end(), std::mt19937(42));
+
+  std::cout << "=== bench_insert n=" << n << " m=" << m << " ===" << std::endl;
+  std::cout << " sequencial: " << std::fixed << std::setprecision(1) << benchInsert(sequential, m) << " ns/insert"
+            << std::endl;
+  std::cout << "  aleatório: " << benchInsert(random, m) << " ns/insert" << std::endl;
+  return 0;
+}
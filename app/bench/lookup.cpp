@@ -0,0 +1,109 @@
+#include "b+tree.h"
+#include <bits/stdc++.h>
+
+// Várias threads consultando o mesmo BPlusTree<int> aberto com loadFromFile.
+// Metade das consultas acerta uma chave (pares) e metade erra (ímpares).
+double benchLookup(const BPlusTree<int>& tree, int n, int queries, int threads) {
+  std::atomic<int> wrong(0);
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::mt19937 rng(t + 1);
+      std::uniform_int_distribution<int> keys(1, 2 * n);
+      for (int q = t; q < queries; q += threads) {
+        int key = keys(rng);
+        if (tree.search(key) != (key % 2 == 0))
+          wrong++;
+      }
+    });
+  }
+  for (auto& worker : workers)
+    worker.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  if (wrong) {
+    std::cerr << "Erro: " << wrong << " consultas com resultado errado" << std::endl;
+    exit(1);
+  }
+  return queries / seconds;
+}
+
+// Confere o kernel contra std::upper_bound em nós de 0 a 1100 chaves.
+bool checkKernel(KeySearchFn fn) {
+  std::mt19937 rng(7);
+  std::vector<int32_t> keys;
+  for (int trial = 0; trial < 20000; trial++) {
+    keys.resize(rng() % 1101);
+    for (auto& key : keys)
+      key = rng() % 1000 - 500;
+    std::sort(keys.begin(), keys.end());
+
+    int32_t key = rng() % 1100 - 550;
+    if (fn(keys.data(), keys.size(), key) != keySearchStd(keys.data(), keys.size(), key))
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int n = argc > 1 ? std::stoi(argv[1]) : 1000000;
+  int queries = argc > 2 ? std::stoi(argv[2]) : 2000000;
+  int maxThreads = argc > 3 ? std::stoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+  int64_t cachePages = argc > 4 ? std::stoll(argv[4]) : INT32_MAX;
+
+  std::string path = "/tmp/bench_lookup_" + std::to_string(getpid()) + ".bin";
+
+  std::vector<int> keys(n);
+  for (int i = 0; i < n; i++)
+    keys[i] = 2 * (i + 1);
+
+  BPlusTree<int> builder(170);
+  if (builder.bulkLoadToFile(path, keys.begin(), keys.end()) < 0)
+    return 1;
+
+  BPlusTree<int> tree(170);
+  if (!tree.loadFromFile(path, cachePages)) {
+    unlink(path.c_str());
+    return 1;
+  }
+  unlink(path.c_str());
+
+  std::cout << "=== bench_lookup n=" << n << " consultas=" << queries << " cache=" << tree.getCacheCapacity()
+            << " páginas ===" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+
+  // Primeira passada só aquece o cache.
+  benchLookup(tree, n, queries, 1);
+
+  std::vector<std::pair<const char*, KeySearchFn>> kernels = {{"upper_bound", keySearchStd},
+                                                              {"escalar", keySearchScalar}};
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"AVX2", keySearchAVX2});
+
+  for (auto& kernel : kernels) {
+    if (!checkKernel(kernel.second)) {
+      std::cerr << "Erro: kernel " << kernel.first << " divergiu de std::upper_bound" << std::endl;
+      return 1;
+    }
+    tree.setKeySearch(kernel.second);
+    std::cout << " " << std::setw(11) << kernel.first << ": " << benchLookup(tree, n, queries, 1) / 1e6
+              << " M consultas/s" << std::endl;
+  }
+  tree.setKeySearch(keySearchDefault());
+
+  double base = 0;
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    double qps = benchLookup(tree, n, queries, threads);
+    if (threads == 1)
+      base = qps;
+    std::cout << " " << std::setw(3) << threads << " threads: " << qps / 1e6 << " M consultas/s (" << qps / base
+              << "x)" << std::endl;
+  }
+
+  BufferPoolStats stats = tree.getCacheStats();
+  std::cout << " cache: " << stats.hits << " acertos, " << stats.misses << " faltas, " << stats.evictions
+            << " despejos" << std::endl;
+  return 0;
+}
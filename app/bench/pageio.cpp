@@ -0,0 +1,105 @@
+#include "b+tree.h"
+#include "recordstore.h"
+#include <bits/stdc++.h>
+
+#define BATCH_IDS 1024
+
+// Tira o arquivo do cache de páginas do kernel, para medir leituras frias.
+void dropCache(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+std::unique_ptr<PageReader> openReader(const std::string& backend, size_t depth) {
+  if (backend == "pread")
+    return std::unique_ptr<PageReader>(new PreadReader());
+
+  std::unique_ptr<UringReader> uring(new UringReader());
+  if (!uring->setup(depth))
+    return nullptr;
+  return uring;
+}
+
+// multiGet de ids em lotes de BATCH_IDS, com o hash.bin frio.
+double benchRecords(const std::string& path, const std::vector<int>& ids, bool direct) {
+  dropCache(path);
+  RecordStore store;
+  if (!store.open(path, RecordStore::RANDOM, false, direct)) {
+    std::cerr << "Erro: não foi possível abrir " << path << (direct ? " com O_DIRECT" : "") << std::endl;
+    exit(1);
+  }
+
+  std::vector<Record> records;
+  std::vector<bool> found;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t first = 0; first < ids.size(); first += BATCH_IDS)
+    store.multiGet(ids.data() + first, std::min<size_t>(BATCH_IDS, ids.size() - first), records, found);
+  return ids.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// searchMany de ids em lotes de BATCH_IDS, com o idx1 frio.
+double benchIndex(const std::string& path, const std::vector<int>& ids) {
+  dropCache(path);
+  BPlusTree<int> tree(170);
+  if (!tree.loadFromFile(path)) {
+    std::cerr << "Erro: não foi possível abrir " << path << std::endl;
+    exit(1);
+  }
+
+  std::vector<bool> found;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t first = 0; first < ids.size(); first += BATCH_IDS)
+    tree.searchMany(ids.data() + first, std::min<size_t>(BATCH_IDS, ids.size() - first), found);
+  return ids.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Uso: " << argv[0] << " <hash.bin> <idx1.bin> [consultas] [--direct]" << std::endl;
+    return 1;
+  }
+  std::string hashPath = argv[1];
+  std::string idx1Path = argv[2];
+  int queries = argc > 3 && argv[3][0] != '-' ? std::stoi(argv[3]) : 20000;
+  bool direct = std::string(argv[argc - 1]) == "--direct";
+
+  RecordStore store;
+  if (!store.open(hashPath)) {
+    std::cerr << "Erro: não foi possível abrir " << hashPath << std::endl;
+    return 1;
+  }
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> keys(1, std::max<int64_t>(1, store.recordCount()));
+  std::vector<int> ids(queries);
+  for (int& id : ids)
+    id = keys(rng);
+  store.close();
+
+  std::cout << "=== bench_pageio consultas=" << queries << " lote=" << BATCH_IDS << (direct ? " O_DIRECT" : "")
+            << " ===" << std::endl;
+  std::cout << std::fixed << std::setprecision(0);
+
+  for (std::string backend : {"pread", "io_uring"}) {
+    for (size_t depth = 1; depth <= 64; depth *= 2) {
+      if (backend == "pread" && depth > 1)
+        break;
+      std::unique_ptr<PageReader> reader = openReader(backend, depth);
+      if (!reader) {
+        std::cout << " io_uring indisponível" << std::endl;
+        break;
+      }
+      size_t actual = reader->depth();
+      setThreadPageReader(std::move(reader));
+
+      double records = benchRecords(hashPath, ids, direct);
+      double index = benchIndex(idx1Path, ids);
+      std::cout << " " << std::setw(8) << backend << " profundidade " << std::setw(2) << actual
+                << ": hash.bin " << std::setw(8) << records << " registros/s, idx1 " << std::setw(8) << index
+                << " buscas/s" << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "scankernels.h"
+#include <bits/stdc++.h>
+
+// RangeFilter32Fn ou RangeFilter64Fn.
+template <typename V>
+using RangeFilterFn = void (*)(const V*, size_t, V, V, uint64_t*);
+
+// Valores pequenos para que lo e hi caiam com frequência em cima de um
+// valor, com os extremos do tipo de vez em quando.
+template <typename V>
+V randomValue(std::mt19937_64& rng) {
+  switch (rng() % 16) {
+  case 0:
+    return std::numeric_limits<V>::min();
+  case 1:
+    return std::numeric_limits<V>::max();
+  default:
+    return (V) (rng() % 200) - 100;
+  }
+}
+
+// Confere o kernel contra o escalar em pedaços de 0 a 4 palavras mais um
+// resto de 0 a 63 linhas, com seleções de entrada que têm palavras zeradas
+// (que o AVX2 pula), cheias e com bits quaisquer.
+template <typename V>
+bool checkKernel(RangeFilterFn<V> fn, RangeFilterFn<V> reference) {
+  std::mt19937_64 rng(7);
+  std::vector<V> values;
+  std::vector<uint64_t> expected, selection;
+  for (int trial = 0; trial < 20000; trial++) {
+    size_t n = rng() % 5 * 64 + trial % 64;
+    values.resize(n);
+    for (auto& value : values)
+      value = randomValue<V>(rng);
+
+    selectAll(n, expected);
+    for (auto& word : expected) {
+      int kind = rng() % 4;
+      if (kind == 0)
+        word = 0;
+      else if (kind == 1)
+        word &= rng();
+    }
+    selection = expected;
+
+    V lo = randomValue<V>(rng), hi = randomValue<V>(rng);
+    if (rng() % 4 && lo > hi)
+      std::swap(lo, hi);
+    reference(values.data(), n, lo, hi, expected.data());
+    fn(values.data(), n, lo, hi, selection.data());
+    if (selection != expected)
+      return false;
+  }
+  return true;
+}
+
+// Linhas por segundo do kernel filtrando a coluna inteira, com metade dos
+// valores dentro do intervalo.
+template <typename V>
+double benchKernel(RangeFilterFn<V> fn, const std::vector<V>& values, int rounds) {
+  std::vector<uint64_t> selection;
+  int64_t selected = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    selectAll(values.size(), selection);
+    fn(values.data(), values.size(), 0, 49, selection.data());
+    selected += countSelected(selection.data(), selection.size());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (selected == 0)
+    std::cerr << "Aviso: nenhuma linha selecionada" << std::endl;
+  return (double) values.size() * rounds / seconds;
+}
+
+template <typename V>
+bool runKernels(const char* type, RangeFilterFn<V> scalar, RangeFilterFn<V> avx2, size_t n, int rounds) {
+  std::vector<std::pair<const char*, RangeFilterFn<V>>> kernels = {{"escalar", scalar}};
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"AVX2", avx2});
+
+  std::mt19937_64 rng(1);
+  std::vector<V> values(n);
+  for (auto& value : values)
+    value = rng() % 100;
+
+  for (auto& kernel : kernels) {
+    if (!checkKernel(kernel.second, scalar)) {
+      std::cerr << "Erro: kernel " << kernel.first << " de " << type << " divergiu do escalar" << std::endl;
+      return false;
+    }
+    std::cout << " " << type << " " << std::setw(7) << kernel.first << ": "
+              << benchKernel(kernel.second, values, rounds) / 1e6 << " M linhas/s" << std::endl;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  size_t n = argc > 1 ? std::stoull(argv[1]) : 16000000;
+  int rounds = argc > 2 ? std::stoi(argv[2]) : 10;
+
+  std::cout << "=== bench_scan n=" << n << " rodadas=" << rounds << " ===" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+
+  if (!runKernels<int32_t>("int32", rangeFilter32Scalar, rangeFilter32AVX2, n, rounds) ||
+      !runKernels<int64_t>("int64", rangeFilter64Scalar, rangeFilter64AVX2, n, rounds))
+    return 1;
+  return 0;
+}
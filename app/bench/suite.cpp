@@ -0,0 +1,301 @@
+#include "b+tree.h"
+#include "datagen.h"
+#include "iostats.h"
+#include "query.h"
+#include "recordstore.h"
+#include "textindex.h"
+#include <bits/stdc++.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Suíte reprodutível: gera um artigo.csv sintético num diretório de
+// trabalho, roda o upload e mede cargas de findrec, seek1 e seek2 em
+// processo, com as mesmas funções de consulta das ferramentas. O resultado
+// sai em stdout como um objeto JSON; o progresso vai para stderr.
+
+struct WorkloadResult {
+  std::string name;
+  int64_t queries;
+  int64_t found;
+  double seconds;
+  std::vector<int64_t> micros;
+  int64_t blocks;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int64_t fileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+// Zipf com s = 1 sobre n chaves: devolve a posição (0 = mais popular).
+class ZipfSampler {
+private:
+  std::vector<double> cdf;
+  std::vector<int64_t> ranks;
+
+public:
+  ZipfSampler(int64_t n) {
+    // Acima de 1M chaves a cauda é agrupada em faixas de largura
+    // crescente, o que mantém a tabela pequena para N = 10M.
+    double total = 0;
+    for (int64_t k = 1; k <= n; k++) {
+      total += 1.0 / k;
+      if (k < (1 << 20) || k % 64 == 0 || k == n) {
+        cdf.push_back(total);
+        ranks.push_back(k);
+      }
+    }
+    for (double& c : cdf)
+      c /= total;
+  }
+
+  int64_t operator()(std::mt19937_64& rng) {
+    double u = (rng() >> 11) * 0x1.0p-53;
+    size_t i = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+    i = std::min(i, ranks.size() - 1);
+    int64_t hi = ranks[i], lo = i ? ranks[i - 1] + 1 : 1;
+    return lo + (int64_t) (rng() % (hi - lo + 1)) - 1;
+  }
+};
+
+// Espalha as posições da Zipf pelos ids, para os mais populares não serem
+// vizinhos no arquivo.
+int scatterId(int64_t rank, int64_t n) {
+  return (int) ((rank * 2654435761ull) % n) + 1;
+}
+
+template <typename Query>
+WorkloadResult runWorkload(const std::string& name, int64_t queries, Query query) {
+  std::cerr << "  " << name << "..." << std::endl;
+  WorkloadResult result = {name, queries, 0, 0, {}, 0};
+  result.micros.reserve(queries);
+
+  ioStats().reset();
+  auto t0 = std::chrono::steady_clock::now();
+  for (int64_t q = 0; q < queries; q++) {
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream out;
+    if (query(q, out) == 0)
+      result.found++;
+    result.micros.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+  result.seconds = secondsSince(t0);
+  result.blocks = ioStats().total().blocks;
+  return result;
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, double p) {
+  return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))];
+}
+
+void printWorkload(std::ostream& out, WorkloadResult& w) {
+  std::sort(w.micros.begin(), w.micros.end());
+  out << "{\"name\":\"" << w.name << "\",\"queries\":" << w.queries << ",\"found\":" << w.found
+      << ",\"qps\":" << std::fixed << std::setprecision(1) << w.queries / w.seconds
+      << ",\"p50_us\":" << percentile(w.micros, 0.50) << ",\"p95_us\":" << percentile(w.micros, 0.95)
+      << ",\"p99_us\":" << percentile(w.micros, 0.99) << ",\"max_us\":" << (w.micros.empty() ? 0 : w.micros.back())
+      << ",\"distinct_blocks\":" << w.blocks << "}";
+}
+
+// Roda upload com o diretório de trabalho como cwd (ele grava em data/db).
+bool runUpload(const std::string& upload, const std::string& dir, const std::vector<std::string>& options) {
+  pid_t pid = fork();
+  if (pid < 0)
+    return false;
+  if (pid == 0) {
+    if (chdir(dir.c_str()) != 0)
+      _exit(127);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    std::vector<char*> args = {const_cast<char*>(upload.c_str())};
+    for (const auto& option : options)
+      args.push_back(const_cast<char*>(option.c_str()));
+    args.push_back(const_cast<char*>("data/artigo.csv"));
+    args.push_back(nullptr);
+    execv(upload.c_str(), args.data());
+    _exit(127);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  int64_t records = 100000;
+  int64_t queries = 20000;
+  uint64_t seed = 1;
+  std::string dir;
+  std::vector<std::string> uploadOptions;
+  bool keep = false;
+  bool usage = false;
+
+  for (int i = 1; i < argc && !usage; i++) {
+    std::string arg = argv[i];
+    try {
+      if (arg == "--records" && i + 1 < argc)
+        records = std::stoll(argv[++i]);
+      else if (arg == "--queries" && i + 1 < argc)
+        queries = std::stoll(argv[++i]);
+      else if (arg == "--seed" && i + 1 < argc)
+        seed = std::stoull(argv[++i]);
+      else if (arg == "--dir" && i + 1 < argc)
+        dir = argv[++i];
+      else if (arg == "--upload" && i + 1 < argc)
+        uploadOptions.push_back(argv[++i]);
+      else if (arg == "--keep")
+        keep = true;
+      else
+        usage = true;
+    } catch (const std::exception& e) {
+      usage = true;
+    }
+  }
+  if (usage || records < 1 || records > INT32_MAX / 2 || queries < 1) {
+    std::cerr << "Uso: " << argv[0]
+              << " [--records N] [--queries N] [--seed S] [--dir <diretório>] [--upload <opção>]... [--keep]"
+              << std::endl;
+    return 1;
+  }
+
+  // O upload é o binário ao lado deste.
+  char self[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (length <= 0) {
+    std::cerr << "Erro: não foi possível localizar o binário do upload" << std::endl;
+    return 1;
+  }
+  self[length] = '\0';
+  std::string upload = std::string(self).substr(0, std::string(self).rfind('/') + 1) + "upload";
+
+  bool temporary = dir.empty();
+  if (temporary)
+    dir = "/tmp/bench_suite_" + std::to_string(getpid());
+  std::string db = dir + "/data/db/";
+  mkdir(dir.c_str(), 0755);
+  mkdir((dir + "/data").c_str(), 0755);
+  mkdir(db.c_str(), 0755);
+
+  std::cerr << "=== bench_suite registros=" << records << " consultas=" << queries << " semente=" << seed << " ("
+            << dir << ") ===" << std::endl;
+
+  // Geração do CSV, guardando os títulos para as consultas de prefixo.
+  std::cerr << "  gerando artigo.csv..." << std::endl;
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::string> titles;
+  {
+    std::ofstream csv(dir + "/data/artigo.csv", std::ios::binary);
+    ArticleGenerator generator(seed);
+    std::string buffer;
+    size_t sampleEvery = std::max<int64_t>(1, records / 10000);
+    for (int64_t i = 0; i < records; i++) {
+      size_t start = buffer.size();
+      generator.nextLine(buffer);
+      if (i % sampleEvery == 0) {
+        // Título é o segundo campo; as aspas são descartadas como no upload.
+        size_t open = buffer.find(";\"", start) + 2, close = buffer.find("\";\"", open);
+        std::string title = buffer.substr(open, close - open);
+        title.erase(std::remove(title.begin(), title.end(), '"'), title.end());
+        titles.push_back(title);
+      }
+      if (buffer.size() >= (1 << 20)) {
+        csv.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    }
+    csv.write(buffer.data(), buffer.size());
+    if (!csv) {
+      std::cerr << "Erro: não foi possível escrever " << dir << "/data/artigo.csv" << std::endl;
+      return 1;
+    }
+  }
+  double generateSeconds = secondsSince(t0);
+
+  std::cerr << "  upload..." << std::endl;
+  t0 = std::chrono::steady_clock::now();
+  if (!runUpload(upload, dir, uploadOptions)) {
+    std::cerr << "Erro: upload falhou (" << upload << ")" << std::endl;
+    return 1;
+  }
+  double uploadSeconds = secondsSince(t0);
+
+  RecordStore store;
+  BPlusTree<int> idx1(170);
+  BPlusTree<std::pair<std::string, int>> idx2(6);
+  TextIndex text;
+  if (!store.open(db + "hash.bin") || !idx1.loadFromFile(db + "idx1.bin") || !idx2.loadFromFile(db + "idx2.bin") ||
+      !text.open(db + "text.bin")) {
+    std::cerr << "Erro: não foi possível abrir a base gerada em " << db << std::endl;
+    return 1;
+  }
+
+  std::mt19937_64 rng(seed);
+  ZipfSampler zipf(records);
+  auto uniformId = [&] { return (int) (rng() % records) + 1; };
+  auto zipfId = [&] { return scatterId(zipf(rng), records); };
+  // Nove em cada dez consultas pedem ids que não existem.
+  auto missId = [&] { return rng() % 10 ? (int) (records + 1 + rng() % records) : uniformId(); };
+
+  std::vector<WorkloadResult> results;
+  results.push_back(runWorkload("findrec_uniform", queries,
+                                [&](int64_t, std::ostream& out) { return findrecQuery(store, uniformId(), out); }));
+  results.push_back(runWorkload("findrec_zipf", queries,
+                                [&](int64_t, std::ostream& out) { return findrecQuery(store, zipfId(), out); }));
+  results.push_back(runWorkload("findrec_miss", queries,
+                                [&](int64_t, std::ostream& out) { return findrecQuery(store, missId(), out); }));
+  results.push_back(runWorkload("seek1_uniform", queries, [&](int64_t, std::ostream& out) {
+    return seek1Query(idx1, store, uniformId(), out);
+  }));
+  results.push_back(runWorkload("seek1_zipf", queries,
+                                [&](int64_t, std::ostream& out) { return seek1Query(idx1, store, zipfId(), out); }));
+  results.push_back(runWorkload("seek1_miss", queries,
+                                [&](int64_t, std::ostream& out) { return seek1Query(idx1, store, missId(), out); }));
+
+  // Prefixos de 4 a 12 bytes de títulos existentes, 10 resultados por página.
+  results.push_back(runWorkload("seek2_prefix", queries, [&](int64_t, std::ostream& out) {
+    const std::string& title = titles[rng() % titles.size()];
+    std::string prefix = title.substr(0, std::min<size_t>(title.size(), 4 + rng() % 9));
+    return seek2Query(idx2, &text, store, prefix, out, 0, 10);
+  }));
+  // Uma palavra do meio do título, em minúsculas como no gerador: nenhum
+  // título (sempre com inicial maiúscula) começa com ela, então a consulta
+  // cai na busca por substring do text.bin, bem mais cara, por isso com
+  // menos consultas.
+  int64_t substringQueries = std::max<int64_t>(1, queries / 100);
+  results.push_back(runWorkload("seek2_substring", substringQueries, [&](int64_t, std::ostream& out) {
+    const std::string& title = titles[rng() % titles.size()];
+    size_t space = title.find(' ');
+    std::string word = space == std::string::npos ? title : title.substr(space + 1, 6);
+    return seek2Query(idx2, &text, store, word, out, 0, 10);
+  }));
+
+  std::ostream& out = std::cout;
+  out << "{\"suite\":\"bd1\",\"records\":" << records << ",\"queries\":" << queries << ",\"seed\":" << seed
+      << std::fixed << std::setprecision(3) << ",\"generate_s\":" << generateSeconds
+      << ",\"upload_s\":" << uploadSeconds << ",\"upload_records_per_s\":" << std::setprecision(1)
+      << records / uploadSeconds << ",\"io\":\"" << threadPageReader().name() << "\",\"files\":{";
+  const char* files[] = {"artigo.csv", "db/hash.bin", "db/idx1.bin", "db/idx2.bin", "db/idx_year.bin",
+                         "db/idx_cites.bin", "db/text.bin", "db/col_id.bin", "db/col_year.bin", "db/col_cites.bin",
+                         "db/col_datetime.bin", "db/col_title.off", "db/col_title.bin", "db/col_authors.off",
+                         "db/col_authors.bin"};
+  for (size_t i = 0; i < sizeof(files) / sizeof(*files); i++)
+    out << (i ? "," : "") << "\"" << files[i] << "\":" << fileSize(dir + "/data/" + files[i]);
+  out << "},\"workloads\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    out << (i ? "," : "");
+    printWorkload(out, results[i]);
+  }
+  out << "]}" << std::endl;
+
+  // O diretório temporário sai inteiro, com o que o upload tiver gravado
+  // além dos arquivos listados acima.
+  if (temporary && !keep) {
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+  }
+  return 0;
+}
@@ -1,250 +1,781 @@
 #ifndef BPLUSTREE_H
 #define BPLUSTREE_H
 
+#include "bufferpool.h"
+#include "keysearch.h"
+#include "pageio.h"
 #include "record.h"
 #include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define INDEX_CACHE_PAGES 4096
 
 template <typename T>
 class BPlusTree {
 private:
 
   template <typename U = T>
-  typename std::enable_if<!std::is_same<U, std::pair<std::string, int>>::value>::type
+  typename std::enable_if<!std::is_same<U, std::pair<std::string, int>>::value &&
+                          !std::is_same<U, std::pair<int, int>>::value>::type
   print_key(const T& key) const {
     std::cout << key << std::endl;
   }
 
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value>::type
+  print_key(const std::pair<int, int>& key) const {
+    std::cout << "(" << key.first << ", " << key.second << ")" << std::endl;
+  }
+
   template <typename U = T>
   typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value>::type
   print_key(const std::pair<std::string, int>& key) const {
     std::cout << "(" << key.second << ", " << key.first << ")" << std::endl;
   }
 
+  // Nó da árvore montada em memória (insert, bulkLoad, saveToFile).
   struct Node {
     bool isLeaf;
     std::vector<T> keys;
     std::vector<Node*> children;
     Node* next;
 
-    bool isLoaded;
     int nodeId;
-    std::streampos filePosition;
   };
 
   Node* root;
   int m;
 
-  mutable std::ifstream lazyFile;
+  struct FileHeader {
+    char magic[4];
+    int32_t version;
+    int32_t keyType;
+    int32_t m;
+    int32_t rootPage;
+    int32_t height;
+    int32_t nodeCount;
+    int32_t pageCount;
+  };
+
+  struct PageHeader {
+    uint8_t isLeaf;
+    uint8_t reserved;
+    uint16_t keyCount;
+    int32_t pageCount;
+    int32_t next;
+  };
+
+  static constexpr int32_t FILE_VERSION = 3;
+
+  struct KeyRef {
+    uint32_t offset;
+    uint16_t length;
+    int32_t id;
+  };
+
+  // Nó lido do arquivo (modo lazy), guardado como os bytes das suas páginas:
+  // chaves int (e pares de int) e filhos ficam contíguos no próprio buffer. Chaves string são
+  // expandidas da codificação frontal para um único slab, com uma KeyRef por
+  // chave. Decodificar não aloca nada por chave e o nó nunca é alterado
+  // depois de entrar no buffer pool.
+  struct Page {
+    PageHeader header;
+    int32_t pageId;
+    uint32_t childOffset;
+    std::vector<char> data;
+    std::vector<char> slab;
+    std::vector<KeyRef> refs;
+  };
+
+  // Chave vista sem cópia: o próprio int ou par de int, ou (string_view, id)
+  // para títulos.
+  typedef typename std::conditional<
+      std::is_same<T, int>::value, int,
+      typename std::conditional<std::is_same<T, std::pair<std::string, int>>::value, std::pair<std::string_view, int>,
+                                T>::type>::type KeyView;
+
+  int lazyFd;
   std::string fileName;
-  mutable std::unordered_map<int, Node*> nodeCache;
-  std::unordered_map<int, std::streampos> nodePositions;
+  mutable BufferPool<Page> pool;
+  Page* lazyRoot;
   bool isLazyMode;
+  KeySearchFn keySearch;
+  int height;
+  int totalNodes;
 
-  void saveNodeToFile(std::ofstream& file, Node* node, std::unordered_map<Node*, int>& nodeIds, int& nextId) {
-    if (!node)
-      return;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, int32_t>::type
+  keyType() const {
+    return 1;
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, int32_t>::type
+  keyType() const {
+    return 2;
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, int32_t>::type
+  keyType() const {
+    return 3;
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, size_t>::type
+  keySize(const int* prev, const int& key) const {
+    return sizeof(int32_t);
+  }
+
+  // Chaves string usam codificação frontal dentro do nó: cada chave guarda
+  // só o tamanho do prefixo em comum com a anterior e o sufixo restante.
+  static size_t sharedPrefix(const std::string& a, const std::string& b) {
+    size_t limit = std::min<size_t>(std::min(a.length(), b.length()), UINT16_MAX);
+    size_t len = 0;
+    while (len < limit && a[len] == b[len])
+      len++;
+    return len;
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, size_t>::type
+  keySize(const std::pair<std::string, int>* prev, const std::pair<std::string, int>& key) const {
+    size_t length = std::min<size_t>(key.first.length(), UINT16_MAX);
+    size_t shared = prev ? sharedPrefix(prev->first, key.first) : 0;
+    return 2 * sizeof(uint16_t) + (length - std::min(shared, length)) + sizeof(int32_t);
+  }
+
+  // Chaves compostas (valor, id) dos índices secundários: dois int32.
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, size_t>::type
+  keySize(const std::pair<int, int>* prev, const std::pair<int, int>& key) const {
+    return 2 * sizeof(int32_t);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value>::type
+  saveKey(char*& p, const int* prev, const int& key) const {
+    int32_t value = key;
+    memcpy(p, &value, sizeof(int32_t));
+    p += sizeof(int32_t);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value>::type
+  saveKey(char*& p, const std::pair<std::string, int>* prev, const std::pair<std::string, int>& key) const {
+    uint16_t length = std::min<size_t>(key.first.length(), UINT16_MAX);
+    uint16_t shared = std::min<size_t>(prev ? sharedPrefix(prev->first, key.first) : 0, length);
+    uint16_t suffix = length - shared;
+    memcpy(p, &shared, sizeof(uint16_t));
+    p += sizeof(uint16_t);
+    memcpy(p, &suffix, sizeof(uint16_t));
+    p += sizeof(uint16_t);
+    memcpy(p, key.first.data() + shared, suffix);
+    p += suffix;
+    int32_t value = key.second;
+    memcpy(p, &value, sizeof(int32_t));
+    p += sizeof(int32_t);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value>::type
+  saveKey(char*& p, const std::pair<int, int>* prev, const std::pair<int, int>& key) const {
+    int32_t values[2] = {key.first, key.second};
+    memcpy(p, values, sizeof(values));
+    p += sizeof(values);
+  }
+
+  size_t encodedSize(bool isLeaf, const std::vector<T>& keys) const {
+    size_t size = sizeof(PageHeader);
+    for (size_t i = 0; i < keys.size(); i++)
+      size += keySize(i ? &keys[i - 1] : nullptr, keys[i]);
+    if (!isLeaf)
+      size += (keys.size() + 1) * sizeof(int32_t);
+    return size;
+  }
+
+  size_t nodeSize(Node* node) const {
+    return encodedSize(node->isLeaf, node->keys);
+  }
+
+  static int pagesFor(size_t bytes) {
+    return (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+
+  void encodeNode(std::vector<char>& page, bool isLeaf, const std::vector<T>& keys, const int32_t* childPages,
+                  int32_t next) const {
+    PageHeader header = {};
+    header.isLeaf = isLeaf;
+    header.keyCount = keys.size();
+    header.pageCount = pagesFor(encodedSize(isLeaf, keys));
+    header.next = next;
+
+    page.assign((size_t) header.pageCount * BLOCK_SIZE, '\0');
+    memcpy(page.data(), &header, sizeof(PageHeader));
+
+    char* p = page.data() + sizeof(PageHeader);
+    for (size_t i = 0; i < keys.size(); i++)
+      saveKey(p, i ? &keys[i - 1] : nullptr, keys[i]);
+
+    if (!isLeaf)
+      memcpy(p, childPages, (keys.size() + 1) * sizeof(int32_t));
+  }
 
-    if (nodeIds.find(node) == nodeIds.end())
-      nodeIds[node] = nextId++;
-
-    int nodeId = nodeIds[node];
-    file.write(reinterpret_cast<const char*>(&nodeId), sizeof(int));
-    file.write(reinterpret_cast<const char*>(&node->isLeaf), sizeof(bool));
-
-    size_t keyCount = node->keys.size();
-    file.write(reinterpret_cast<const char*>(&keyCount), sizeof(size_t));
-    for (const auto& key : node->keys)
-      saveKey(file, key);
-
-    if (!node->isLeaf) {
-      size_t childCount = node->children.size();
-      file.write(reinterpret_cast<const char*>(&childCount), sizeof(size_t));
-      for (auto child : node->children) {
-        if (nodeIds.find(child) == nodeIds.end())
-          nodeIds[child] = nextId++;
-        int childId = nodeIds[child];
-        file.write(reinterpret_cast<const char*>(&childId), sizeof(int));
+  void writeFileHeader(std::ofstream& file, int32_t rootPage, int32_t treeHeight, int32_t nodeCount,
+                       int32_t pageCount) const {
+    FileHeader header = {};
+    memcpy(header.magic, "BPT+", 4);
+    header.version = FILE_VERSION;
+    header.keyType = keyType();
+    header.m = m;
+    header.rootPage = rootPage;
+    header.height = treeHeight;
+    header.nodeCount = nodeCount;
+    header.pageCount = pageCount;
+
+    std::vector<char> page(BLOCK_SIZE, '\0');
+    memcpy(page.data(), &header, sizeof(FileHeader));
+    file.seekp(0);
+    file.write(page.data(), BLOCK_SIZE);
+  }
+
+  // Agrupa count filhos em nós de até perNode filhos; o último grupo é
+  // fundido ou equilibrado com o anterior para não ficar com menos de m chaves.
+  std::vector<std::pair<size_t, size_t>> planGroups(size_t count, int perNode) const {
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t start = 0; start < count; start += perNode)
+      groups.push_back({start, std::min(count, start + perNode)});
+
+    auto& tail = groups.back();
+    if (groups.size() > 1 && (int) (tail.second - tail.first) - 1 < m) {
+      auto& prev = groups[groups.size() - 2];
+      size_t combined = tail.second - prev.first;
+      if ((int) combined - 1 <= 2 * m) {
+        prev.second = tail.second;
+        groups.pop_back();
+      } else {
+        prev.second = prev.first + combined / 2;
+        tail.first = prev.second;
       }
     }
+    return groups;
+  }
+
+  // Funde a última folha (com menos de m chaves) na anterior ou reparte as
+  // chaves das duas ao meio; devolve false se a última folha ficou vazia.
+  bool balanceTail(std::vector<T>& prev, std::vector<T>& last) const {
+    if ((int) last.size() >= m)
+      return true;
+
+    prev.insert(prev.end(), last.begin(), last.end());
+    last.clear();
+    if ((int) prev.size() <= 2 * m)
+      return false;
+
+    int half = prev.size() / 2;
+    last.assign(prev.begin() + half, prev.end());
+    prev.erase(prev.begin() + half, prev.end());
+    return true;
+  }
+
+  // Posição que divide keys ao meio em bytes codificados.
+  size_t splitByBytes(const std::vector<T>& keys) const {
+    size_t total = encodedSize(true, keys), size = sizeof(PageHeader);
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+      size += keySize(i ? &keys[i - 1] : nullptr, keys[i]);
+      if (size >= total / 2)
+        return i + 1;
+    }
+    return keys.size() / 2;
+  }
+
+  // Versão por bytes do balanceTail para bulkLoadToFile: a última folha com
+  // menos de meia página é fundida na anterior ou as duas são repartidas
+  // ao meio em bytes.
+  bool balanceTailBytes(std::vector<T>& prev, std::vector<T>& last, size_t budget) const {
+    if (encodedSize(true, last) >= budget / 2)
+      return true;
+
+    prev.insert(prev.end(), last.begin(), last.end());
+    last.clear();
+    if (encodedSize(true, prev) <= budget)
+      return false;
+
+    size_t half = splitByBytes(prev);
+    last.assign(prev.begin() + half, prev.end());
+    prev.erase(prev.begin() + half, prev.end());
+    return true;
+  }
+
+  // Tamanho do nó interno com os filhos [first, last): as chaves são os
+  // separadores dos filhos a partir do segundo.
+  size_t groupSize(const std::vector<T>& separators, size_t first, size_t last) const {
+    size_t size = sizeof(PageHeader) + (last - first) * sizeof(int32_t);
+    for (size_t i = first + 1; i < last; i++)
+      size += keySize(i > first + 1 ? &separators[i - 1] : nullptr, separators[i]);
+    return size;
+  }
 
-    if (node->isLeaf) {
-      int nextId = -1;
-      if (node->next) {
-        if (nodeIds.find(node->next) == nodeIds.end())
-          nodeIds[node->next] = nextId++;
-        nextId = nodeIds[node->next];
+  // Agrupa os filhos de um nível em nós internos de até budget bytes, com
+  // pelo menos dois filhos cada; o último grupo com menos de meia página é
+  // fundido ou equilibrado com o anterior.
+  std::vector<std::pair<size_t, size_t>> packGroups(const std::vector<T>& separators, size_t budget) const {
+    std::vector<std::pair<size_t, size_t>> groups;
+    size_t start = 0;
+    size_t size = sizeof(PageHeader) + sizeof(int32_t);
+    for (size_t i = 1; i < separators.size(); i++) {
+      size_t cost = keySize(i > start + 1 ? &separators[i - 1] : nullptr, separators[i]) + sizeof(int32_t);
+      if (i - start >= 2 && size + cost > budget) {
+        groups.push_back({start, i});
+        start = i;
+        size = sizeof(PageHeader) + sizeof(int32_t);
+      } else {
+        size += cost;
       }
-      file.write(reinterpret_cast<const char*>(&nextId), sizeof(int));
     }
+    groups.push_back({start, separators.size()});
+
+    auto& tail = groups.back();
+    if (groups.size() > 1 && (size < budget / 2 || tail.second - tail.first < 2)) {
+      auto& prev = groups[groups.size() - 2];
+      if (groupSize(separators, prev.first, tail.second) <= budget) {
+        prev.second = tail.second;
+        groups.pop_back();
+      } else {
+        size_t total = groupSize(separators, prev.first, tail.second);
+        size_t split = prev.first + 2;
+        while (split + 2 < tail.second && groupSize(separators, prev.first, split) < total / 2)
+          split++;
+        prev.second = split;
+        tail.first = split;
+      }
+    }
+    return groups;
   }
 
-  template <typename U = T>
-  typename std::enable_if<std::is_same<U, int>::value>::type
-  saveKey(std::ofstream& file, const int& key) {
-    file.write(reinterpret_cast<const char*>(&key), sizeof(int));
+  // Cada thread lê pelo seu próprio PageReader (io_uring ou pread), com
+  // offsets explícitos, então várias threads podem ler o mesmo índice ao
+  // mesmo tempo.
+  bool readPages(int pageId, int count, char* buffer) const {
+    return threadPageReader().read(lazyFd, buffer, (size_t) count * BLOCK_SIZE, (off_t) pageId * BLOCK_SIZE);
   }
 
   template <typename U = T>
-  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value>::type
-  saveKey(std::ofstream& file, const std::pair<std::string, int>& key) {
-    size_t strLen = key.first.length();
-    file.write(reinterpret_cast<const char*>(&strLen), sizeof(size_t));
-    file.write(key.first.c_str(), strLen);
-    file.write(reinterpret_cast<const char*>(&key.second), sizeof(int));
+  typename std::enable_if<std::is_same<U, int>::value, uint32_t>::type
+  indexKeys(Page* page) const {
+    return sizeof(PageHeader) + page->header.keyCount * sizeof(int32_t);
   }
 
   template <typename U = T>
-  typename std::enable_if<std::is_same<U, int>::value, int>::type
-  loadKey(std::ifstream& file) const {
-    int key;
-    file.read(reinterpret_cast<char*>(&key), sizeof(int));
-    return key;
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, uint32_t>::type
+  indexKeys(Page* page) const {
+    return sizeof(PageHeader) + page->header.keyCount * 2 * sizeof(int32_t);
   }
 
+  // Expande as chaves do nó para o slab: uma passada mede o total e outra
+  // copia, de modo que o slab é alocado uma única vez.
   template <typename U = T>
-  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, std::pair<std::string, int>>::type
-  loadKey(std::ifstream& file) const {
-    size_t strLen;
-    file.read(reinterpret_cast<char*>(&strLen), sizeof(size_t));
-    std::string str(strLen, '\0');
-    file.read(&str[0], strLen);
-    int value;
-    file.read(reinterpret_cast<char*>(&value), sizeof(int));
-    return std::make_pair(str, value);
-  }
-
-  Node* loadNodeById(int nodeId) const {
-    auto it = nodeCache.find(nodeId);
-    if (it != nodeCache.end())
-      return it->second;
-
-    auto posIt = nodePositions.find(nodeId);
-    if (posIt == nodePositions.end())
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, uint32_t>::type
+  indexKeys(Page* page) const {
+    const char* data = page->data.data();
+    page->refs.resize(page->header.keyCount);
+
+    uint32_t offset = sizeof(PageHeader);
+    size_t total = 0;
+    for (size_t i = 0; i < page->header.keyCount; i++) {
+      uint16_t shared, suffix;
+      memcpy(&shared, data + offset, sizeof(uint16_t));
+      memcpy(&suffix, data + offset + sizeof(uint16_t), sizeof(uint16_t));
+      total += shared + suffix;
+      offset += 2 * sizeof(uint16_t) + suffix + sizeof(int32_t);
+    }
+    page->slab.resize(total);
+
+    offset = sizeof(PageHeader);
+    uint32_t end = 0;
+    for (size_t i = 0; i < page->header.keyCount; i++) {
+      KeyRef& ref = page->refs[i];
+      uint16_t shared, suffix;
+      memcpy(&shared, data + offset, sizeof(uint16_t));
+      memcpy(&suffix, data + offset + sizeof(uint16_t), sizeof(uint16_t));
+      offset += 2 * sizeof(uint16_t);
+
+      if (i == 0)
+        shared = 0;
+      shared = std::min(shared, page->refs[i ? i - 1 : 0].length);
+
+      ref.offset = end;
+      ref.length = shared + suffix;
+      if (shared)
+        memcpy(page->slab.data() + end, page->slab.data() + page->refs[i - 1].offset, shared);
+      if (suffix)
+        memcpy(page->slab.data() + end + shared, data + offset, suffix);
+      end += ref.length;
+      offset += suffix;
+
+      memcpy(&ref.id, data + offset, sizeof(int32_t));
+      offset += sizeof(int32_t);
+    }
+    return offset;
+  }
+
+  // Devolve o nó da página fixado no buffer pool, lendo-o do arquivo numa
+  // falta. Todo fetch deve ter um release correspondente.
+  Page* fetch(int32_t pageId) const {
+    Page* page = pool.pin(pageId);
+    if (page)
+      return page;
+
+    page = new Page();
+    page->pageId = pageId;
+    page->data.resize(BLOCK_SIZE);
+    if (!readPages(pageId, 1, page->data.data())) {
+      delete page;
       return nullptr;
+    }
+    return finishPage(page);
+  }
 
-    if (!lazyFile.is_open()) {
-      lazyFile.open(fileName, std::ios::binary);
-      if (!lazyFile)
+  // Completa um nó cuja primeira página já foi lida: lê as demais, indexa as
+  // chaves e o coloca no pool, fixado.
+  Page* finishPage(Page* page) const {
+    int32_t pageId = page->pageId;
+    memcpy(&page->header, page->data.data(), sizeof(PageHeader));
+    if (page->header.pageCount > 1) {
+      page->data.resize((size_t) page->header.pageCount * BLOCK_SIZE);
+      if (!readPages(pageId + 1, page->header.pageCount - 1, page->data.data() + BLOCK_SIZE)) {
+        delete page;
         return nullptr;
+      }
     }
 
-    lazyFile.seekg(posIt->second);
-
-    Node* node = new Node();
-    node->nodeId = nodeId;
-    node->isLoaded = true;
-
-    int readNodeId;
-    lazyFile.read(reinterpret_cast<char*>(&readNodeId), sizeof(int));
-    lazyFile.read(reinterpret_cast<char*>(&node->isLeaf), sizeof(bool));
-
-    size_t keyCount;
-    lazyFile.read(reinterpret_cast<char*>(&keyCount), sizeof(size_t));
-    node->keys.reserve(keyCount);
-    for (size_t i = 0; i < keyCount; i++)
-      node->keys.push_back(loadKey(lazyFile));
-
-    if (!node->isLeaf) {
-      size_t childCount;
-      lazyFile.read(reinterpret_cast<char*>(&childCount), sizeof(size_t));
-      node->children.resize(childCount);
-      for (size_t i = 0; i < childCount; i++) {
-        int childId;
-        lazyFile.read(reinterpret_cast<char*>(&childId), sizeof(int));
-
-        Node* childPlaceholder = new Node();
-        childPlaceholder->nodeId = childId;
-        childPlaceholder->isLoaded = false;
-        childPlaceholder->isLeaf = false;
-        childPlaceholder->next = nullptr;
-        node->children[i] = childPlaceholder;
+    page->childOffset = indexKeys(page);
+    return pool.add(pageId, page, std::max<int>(1, page->header.pageCount));
+  }
+
+  // Põe no pool os nós de pages (ordenadas, sem repetição) que ainda não
+  // estão lá, com a primeira página de todos num único lote de leituras.
+  void prefetch(const std::vector<int32_t>& pages) const {
+    std::vector<Page*> missing;
+    for (int32_t pageId : pages) {
+      if (Page* page = pool.pin(pageId)) {
+        pool.unpin(pageId);
+        continue;
       }
-    } else {
-      node->children.clear();
-    }
-
-    if (node->isLeaf) {
-      int nextId;
-      lazyFile.read(reinterpret_cast<char*>(&nextId), sizeof(int));
-      if (nextId != -1) {
-        Node* nextPlaceholder = new Node();
-        nextPlaceholder->nodeId = nextId;
-        nextPlaceholder->isLoaded = false;
-        nextPlaceholder->isLeaf = true;
-        nextPlaceholder->next = nullptr;
-        node->next = nextPlaceholder;
-      } else {
-        node->next = nullptr;
+      Page* page = new Page();
+      page->pageId = pageId;
+      page->data.resize(BLOCK_SIZE);
+      missing.push_back(page);
+    }
+
+    std::vector<PageRead> reads;
+    for (Page* page : missing)
+      reads.push_back({lazyFd, (off_t) page->pageId * BLOCK_SIZE, page->data.data(), BLOCK_SIZE, 0});
+    threadPageReader().readAll(reads.data(), reads.size());
+
+    for (size_t i = 0; i < missing.size(); i++) {
+      if (reads[i].done < BLOCK_SIZE) {
+        delete missing[i];
+        continue;
       }
-    } else {
-      node->next = nullptr;
+      Page* page = finishPage(missing[i]);
+      if (page)
+        pool.unpin(page->pageId);
     }
+  }
 
-    nodeCache[nodeId] = node;
-    return node;
+  // A raiz já está fixada; cada busca a fixa de novo para liberá-la como
+  // qualquer outro nó do caminho.
+  Page* lazyTop() const {
+    return lazyRoot ? fetch(lazyRoot->pageId) : nullptr;
   }
 
-  Node* ensureLoaded(Node* node) const {
-    if (!node)
-      return nullptr;
+  // Acesso uniforme a Node (em memória) e Page (arquivo) para que as buscas
+  // sejam escritas uma vez só.
+  static bool isLeafNode(const Node* node) {
+    return node->isLeaf;
+  }
+
+  static bool isLeafNode(const Page* page) {
+    return page->header.isLeaf;
+  }
+
+  static size_t keyCount(const Node* node) {
+    return node->keys.size();
+  }
+
+  static size_t keyCount(const Page* page) {
+    return page->header.keyCount;
+  }
+
+  static int32_t childPage(const Page* page, size_t i) {
+    int32_t child;
+    memcpy(&child, page->data.data() + page->childOffset + i * sizeof(int32_t), sizeof(int32_t));
+    return child;
+  }
+
+  Node* childAt(Node* node, size_t i) const {
+    return node->children[i];
+  }
+
+  Page* childAt(Page* page, size_t i) const {
+    return fetch(childPage(page, i));
+  }
+
+  Node* nextLeaf(Node* node) const {
+    return node->next;
+  }
+
+  Page* nextLeaf(Page* page) const {
+    return page->header.next == -1 ? nullptr : fetch(page->header.next);
+  }
+
+  void release(Node* node) const {}
+
+  void release(Page* page) const {
+    if (page)
+      pool.unpin(page->pageId);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<!std::is_same<U, int>::value, size_t>::type
+  upperBound(const Node* node, const T& key) const {
+    return std::upper_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+  }
+
+  template <typename U = T>
+  typename std::enable_if<!std::is_same<U, int>::value, bool>::type
+  containsKey(const Node* node, const T& key) const {
+    return std::binary_search(node->keys.begin(), node->keys.end(), key);
+  }
+
+  // Chaves int usam o kernel de keysearch.h (AVX2 quando disponível).
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, size_t>::type
+  upperBound(const Node* node, const int& key) const {
+    return keySearch(node->keys.data(), node->keys.size(), key);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, bool>::type
+  containsKey(const Node* node, const int& key) const {
+    size_t i = upperBound(node, key);
+    return i > 0 && node->keys[i - 1] == key;
+  }
 
-    if (node->isLoaded || !isLazyMode)
-      return node;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, const int32_t*>::type
+  intKeys(const Page* page) const {
+    return reinterpret_cast<const int32_t*>(page->data.data() + sizeof(PageHeader));
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, size_t>::type
+  upperBound(const Page* page, const int& key) const {
+    return keySearch(intKeys(page), page->header.keyCount, key);
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, bool>::type
+  containsKey(const Page* page, const int& key) const {
+    size_t i = upperBound(page, key);
+    return i > 0 && intKeys(page)[i - 1] == key;
+  }
+
+  template <typename U = T>
+  static typename std::enable_if<std::is_same<U, int>::value || std::is_same<U, std::pair<int, int>>::value,
+                                 KeyView>::type
+  viewOf(const T& key) {
+    return key;
+  }
+
+  template <typename U = T>
+  static typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, KeyView>::type
+  viewOf(const std::pair<std::string, int>& key) {
+    return {key.first, key.second};
+  }
+
+  template <typename U = T>
+  static typename std::enable_if<std::is_same<U, int>::value || std::is_same<U, std::pair<int, int>>::value, T>::type
+  toKey(const KeyView& view) {
+    return view;
+  }
+
+  template <typename U = T>
+  static typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, T>::type
+  toKey(const KeyView& view) {
+    return {std::string(view.first), view.second};
+  }
+
+  KeyView keyView(const Node* node, size_t i) const {
+    return viewOf(node->keys[i]);
+  }
 
-    Node* loadedNode = loadNodeById(node->nodeId);
-    if (loadedNode && loadedNode != node) {
-      node->isLeaf = loadedNode->isLeaf;
-      node->keys = loadedNode->keys;
-      node->children = loadedNode->children;
-      node->next = loadedNode->next;
-      node->isLoaded = true;
-      node->filePosition = loadedNode->filePosition;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, int>::value, KeyView>::type
+  keyView(const Page* page, size_t i) const {
+    return intKeys(page)[i];
+  }
 
-      nodeCache[node->nodeId] = node;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, KeyView>::type
+  keyView(const Page* page, size_t i) const {
+    const KeyRef& ref = page->refs[i];
+    return {std::string_view(page->slab.data() + ref.offset, ref.length), ref.id};
+  }
 
-      if (nodeCache.find(node->nodeId) != nodeCache.end() &&
-          nodeCache[node->nodeId] != loadedNode)
-        delete loadedNode;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, size_t>::type
+  upperBound(const Page* page, const std::pair<std::string, int>& key) const {
+    std::pair<std::string_view, int> target = {key.first, key.second};
+    size_t lo = 0, hi = page->header.keyCount;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (target < keyView(page, mid))
+        hi = mid;
+      else
+        lo = mid + 1;
     }
-    return node->isLoaded ? node : nullptr;
+    return lo;
   }
 
-  std::vector<Node*> findLeaf(const T& key) const {
-    std::vector<Node*> path;
-    auto node = root;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, bool>::type
+  containsKey(const Page* page, const std::pair<std::string, int>& key) const {
+    size_t i = upperBound(page, key);
+    return i > 0 && keyView(page, i - 1) == std::pair<std::string_view, int>(key.first, key.second);
+  }
 
-    if (!node)
-      return path;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, KeyView>::type
+  keyView(const Page* page, size_t i) const {
+    int32_t values[2];
+    memcpy(values, page->data.data() + sizeof(PageHeader) + i * sizeof(values), sizeof(values));
+    return {values[0], values[1]};
+  }
 
-    while (node && !node->isLeaf) {
-      node = ensureLoaded(node);
-      if (!node)
-        break;
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, size_t>::type
+  upperBound(const Page* page, const std::pair<int, int>& key) const {
+    size_t lo = 0, hi = page->header.keyCount;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (key < keyView(page, mid))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
 
-      path.push_back(node);
-      auto it = std::upper_bound(node->keys.begin(), node->keys.end(), key);
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<int, int>>::value, bool>::type
+  containsKey(const Page* page, const std::pair<int, int>& key) const {
+    size_t i = upperBound(page, key);
+    return i > 0 && keyView(page, i - 1) == key;
+  }
 
-      if (it == node->keys.end()) {
-        if (node->children.empty())
-          break;
-        node = node->children.back();
-      } else {
-        int i = std::distance(node->keys.begin(), it);
-        if (i >= (int) node->children.size())
-          break;
-        node = node->children[i];
+  // Posição da primeira chave >= key no nó.
+  template <typename N>
+  size_t lowerBound(const N* node, const T& key) const {
+    KeyView target = viewOf(key);
+    size_t lo = 0, hi = keyCount(node);
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (keyView(node, mid) < target)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  // Desce de node até a folha que pode conter key e a devolve fixada.
+  template <typename N>
+  N* descend(N* node, const T& key) const {
+    while (node && !isLeafNode(node)) {
+      N* child = childAt(node, upperBound(node, key));
+      release(node);
+      node = child;
+    }
+    return node;
+  }
+
+  template <typename N>
+  bool searchFrom(N* node, const T& key) const {
+    N* leaf = descend(node, key);
+    if (!leaf)
+      return false;
+
+    bool found = containsKey(leaf, key);
+    release(leaf);
+    return found;
+  }
+
+  template <typename N>
+  std::vector<std::pair<std::string, int>> substringFrom(N* node, const std::string& substring) const {
+    std::vector<std::pair<std::string, int>> results;
+
+    int depth = 0;
+    while (node && !isLeafNode(node) && depth < 20) {
+      N* child = childAt(node, 0);
+      release(node);
+      node = child;
+      depth++;
+    }
+
+    if (!node || !isLeafNode(node)) {
+      release(node);
+      return results;
+    }
+
+    int maxLeaves = 100;
+    int leavesChecked = 0;
+
+    while (node != nullptr && leavesChecked < maxLeaves) {
+      for (size_t i = 0; i < keyCount(node); i++) {
+        auto key = keyView(node, i);
+        if (substring.empty() || key.first.find(substring) != std::string::npos)
+          results.emplace_back(std::string(key.first), key.second);
       }
+
+      leavesChecked++;
+
+      N* next = leavesChecked < maxLeaves ? nextLeaf(node) : nullptr;
+      release(node);
+      node = next;
     }
+    release(node);
+
+    return results;
+  }
 
-    if (node) {
-      node = ensureLoaded(node);
-      if (node)
-        path.push_back(node);
+  template <typename U = T>
+  auto openCursor(const T& lo, bool bounded, const T& hi) const {
+    if (isLazyMode) {
+      Page* leaf = descend(lazyTop(), lo);
+      return Cursor(this, nullptr, leaf, leaf ? lowerBound(leaf, lo) : 0, bounded, hi);
+    }
+    Node* leaf = descend(root, lo);
+    return Cursor(this, leaf, nullptr, leaf ? lowerBound(leaf, lo) : 0, bounded, hi);
+  }
+
+  // Caminho raiz-folha usado pelas inserções, só na árvore em memória.
+  std::vector<Node*> findLeaf(const T& key) const {
+    std::vector<Node*> path;
+    Node* node = root;
+    while (node) {
+      path.push_back(node);
+      if (node->isLeaf)
+        break;
+      node = node->children[upperBound(node, key)];
     }
     return path;
   }
 
-  void insertInternal(Node* parent, Node* child, const T& key) {
+  void insertInternal(std::vector<Node*>& path, int level, Node* child, const T& key) {
+    Node* parent = path[level];
     auto it = std::upper_bound(parent->keys.begin(), parent->keys.end(), key);
     int i = std::distance(parent->keys.begin(), it);
     parent->keys.insert(it, key);
@@ -263,36 +794,20 @@ private:
       newParent->children.assign(parent->children.begin() + m + 1, parent->children.end());
       parent->children.erase(parent->children.begin() + m + 1, parent->children.end());
 
-      Node* grandParent = findParent(root, parent);
-      if (grandParent == nullptr) {
+      if (level == 0) {
         Node* newRoot = new Node();
         newRoot->isLeaf = false;
         newRoot->keys.push_back(midKey);
         newRoot->children.push_back(parent);
         newRoot->children.push_back(newParent);
         root = newRoot;
+        height++;
       } else {
-        insertInternal(grandParent, newParent, midKey);
+        insertInternal(path, level - 1, newParent, midKey);
       }
     }
   }
 
-  Node* findParent(Node* node, Node* child) {
-    if (node == nullptr || node->isLeaf)
-      return nullptr;
-
-    for (auto c : node->children)
-      if (c == child)
-        return node;
-
-    for (auto c : node->children) {
-      Node* parent = findParent(c, child);
-      if (parent != nullptr)
-        return parent;
-    }
-    return nullptr;
-  }
-
   template <typename U = T>
   typename std::enable_if<!std::is_same<U, std::pair<std::string, int>>::value, T>::type
   get_separator(const T& key, const T& last_key_in_prev_node) {
@@ -327,15 +842,29 @@ private:
 
 public:
 
-  BPlusTree(int m) : m(m), isLazyMode(false) {
+  BPlusTree(int m) : m(m), lazyFd(-1), pool(INDEX_CACHE_PAGES), lazyRoot(nullptr), isLazyMode(false),
+                      keySearch(keySearchDefault()), height(1), totalNodes(1) {
     root = new Node();
     root->isLeaf = true;
     root->next = nullptr;
-    root->isLoaded = true;
     root->nodeId = -1;
   }
 
+  BPlusTree(const BPlusTree&) = delete;
+  BPlusTree& operator=(const BPlusTree&) = delete;
+
+  ~BPlusTree() {
+    if (lazyFd >= 0)
+      close(lazyFd);
+  }
+
+  // Índices abertos com loadFromFile são somente leitura.
   void insert(const T& key) {
+    if (isLazyMode) {
+      std::cerr << "Erro: inserção em índice aberto de " << fileName << std::endl;
+      return;
+    }
+
     auto path = findLeaf(key);
     auto leaf = path.back();
 
@@ -346,125 +875,267 @@ public:
       Node* newLeaf = new Node();
       newLeaf->isLeaf = true;
 
-      T last_key_in_old_leaf = leaf->keys.back();
-
       newLeaf->keys.assign(leaf->keys.begin() + m, leaf->keys.end());
       leaf->keys.erase(leaf->keys.begin() + m, leaf->keys.end());
 
+      T last_key_in_old_leaf = leaf->keys.back();
+
       newLeaf->next = leaf->next;
       leaf->next = newLeaf;
 
       T midKey = get_separator(newLeaf->keys[0], last_key_in_old_leaf);
-      Node* parent = findParent(root, leaf);
 
-      if (parent == nullptr) {
+      if (path.size() == 1) {
         Node* newRoot = new Node();
         newRoot->isLeaf = false;
         newRoot->keys.push_back(midKey);
         newRoot->children.push_back(leaf);
         newRoot->children.push_back(newLeaf);
         root = newRoot;
+        height++;
       } else {
-        insertInternal(parent, newLeaf, midKey);
+        insertInternal(path, path.size() - 2, newLeaf, midKey);
       }
     }
   }
 
-  Node* search(const T& key) const {
-    auto path = findLeaf(key);
-    if (path.empty())
-      return nullptr;
+  template <typename InputIt>
+  void bulkLoad(InputIt first, InputIt last, double fillFactor = 1.0) {
+    int fill = std::max(m, std::min(2 * m, (int) std::lround(2 * m * fillFactor)));
+
+    std::vector<Node*> level;
+    Node* leaf = nullptr;
+    for (; first != last; ++first) {
+      if (!leaf || (int) leaf->keys.size() == fill) {
+        Node* newLeaf = new Node();
+        newLeaf->isLeaf = true;
+        newLeaf->nodeId = -1;
+        newLeaf->keys.reserve(fill);
+        if (leaf)
+          leaf->next = newLeaf;
+        level.push_back(newLeaf);
+        leaf = newLeaf;
+      }
+      leaf->keys.push_back(*first);
+    }
 
-    auto leaf = path.back();
-    leaf = ensureLoaded(leaf);
-    if (!leaf)
-      return nullptr;
+    if (level.empty())
+      return;
+
+    if (level.size() > 1) {
+      Node* prev = level[level.size() - 2];
+      if (!balanceTail(prev->keys, leaf->keys)) {
+        prev->next = nullptr;
+        delete leaf;
+        level.pop_back();
+      }
+    }
+
+    std::vector<T> separators(level.size());
+    for (size_t i = 1; i < level.size(); i++)
+      separators[i] = get_separator(level[i]->keys[0], level[i - 1]->keys.back());
+
+    int levels = 1;
+    while (level.size() > 1) {
+      std::vector<Node*> parents;
+      std::vector<T> parentSeparators;
+      for (auto& group : planGroups(level.size(), fill + 1)) {
+        Node* parent = new Node();
+        parent->isLeaf = false;
+        parent->nodeId = -1;
+        parent->next = nullptr;
+        parent->children.assign(level.begin() + group.first, level.begin() + group.second);
+        parent->keys.assign(separators.begin() + group.first + 1, separators.begin() + group.second);
+        parents.push_back(parent);
+        parentSeparators.push_back(separators[group.first]);
+      }
 
-    return std::binary_search(leaf->keys.begin(), leaf->keys.end(), key) ? leaf : nullptr;
+      level.swap(parents);
+      separators.swap(parentSeparators);
+      levels++;
+    }
+
+    if (root && root->isLeaf && root->keys.empty())
+      delete root;
+
+    root = level[0];
+    height = levels;
+  }
+
+  bool search(const T& key) const {
+    return isLazyMode ? searchFrom(lazyTop(), key) : searchFrom(root, key);
+  }
+
+  // search() para count chaves de uma vez. No modo lazy a descida é feita
+  // nível a nível: os nós de que as chaves precisam em cada nível são lidos
+  // num só lote (prefetch), de modo que as leituras de chaves diferentes
+  // ficam em andamento juntas.
+  void searchMany(const T* keys, size_t count, std::vector<bool>& found) const {
+    found.assign(count, false);
+    if (!isLazyMode) {
+      for (size_t i = 0; i < count; i++)
+        found[i] = searchFrom(root, keys[i]);
+      return;
+    }
+
+    std::vector<int32_t> at(count, lazyRoot ? lazyRoot->pageId : -1);
+    std::vector<int32_t> pages;
+    for (;;) {
+      pages.clear();
+      for (int32_t pageId : at)
+        if (pageId != -1)
+          pages.push_back(pageId);
+      if (pages.empty())
+        break;
+      std::sort(pages.begin(), pages.end());
+      pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+      prefetch(pages);
+
+      for (size_t i = 0; i < count; i++) {
+        if (at[i] == -1)
+          continue;
+        Page* page = fetch(at[i]);
+        if (!page) {
+          at[i] = -1;
+        } else if (isLeafNode(page)) {
+          found[i] = containsKey(page, keys[i]);
+          at[i] = -1;
+        } else {
+          at[i] = childPage(page, upperBound(page, keys[i]));
+        }
+        release(page);
+      }
+    }
   }
 
   template <typename U = T>
   typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value,
                           std::vector<std::pair<std::string, int>>>::type
   searchBySubstring(const std::string& substring) const {
-    std::vector<std::pair<std::string, int>> results;
+    return isLazyMode ? substringFrom(lazyTop(), substring) : substringFrom(root, substring);
+  }
 
-    auto node = root;
-    if (!node)
-      return results;
+  // Cursor de varredura em ordem a partir de uma chave inicial, até um
+  // limite superior exclusivo (opcional). Mantém fixada só a folha atual e
+  // segue os links next sob demanda, então o custo é proporcional ao número
+  // de chaves percorridas.
+  class Cursor {
+  private:
+    friend class BPlusTree;
+
+    const BPlusTree* tree;
+    Node* node;
+    Page* page;
+    size_t index;
+    bool bounded;
+    T hi;
+
+    Cursor(const BPlusTree* tree, Node* node, Page* page, size_t index, bool bounded, const T& hi)
+        : tree(tree), node(node), page(page), index(index), bounded(bounded), hi(hi) {
+      settle();
+    }
 
-    int depth = 0;
-    while (depth < 20) {
-      node = ensureLoaded(node);
-      if (!node)
-        return results;
+    size_t count() const {
+      return page ? tree->keyCount(page) : tree->keyCount(node);
+    }
 
-      if (node->isLeaf)
-        break;
+    void finish() {
+      tree->release(page);
+      page = nullptr;
+      node = nullptr;
+    }
 
-      if (node->children.empty())
-        return results;
+    // Passa às próximas folhas quando a atual se esgota e encerra ao
+    // alcançar hi.
+    void settle() {
+      while (valid() && index >= count()) {
+        if (page) {
+          Page* next = tree->nextLeaf(page);
+          tree->release(page);
+          page = next;
+        } else {
+          node = tree->nextLeaf(node);
+        }
+        index = 0;
+      }
+      if (valid() && bounded && !(view() < viewOf(hi)))
+        finish();
+    }
 
-      node = node->children[0];
-      depth++;
+  public:
+    Cursor(Cursor&& other)
+        : tree(other.tree), node(other.node), page(other.page), index(other.index), bounded(other.bounded),
+          hi(std::move(other.hi)) {
+      other.node = nullptr;
+      other.page = nullptr;
     }
 
-    if (depth >= 20 || !node || !node->isLeaf)
-      return results;
+    Cursor(const Cursor&) = delete;
+    Cursor& operator=(const Cursor&) = delete;
 
-    int maxLeaves = 100;
-    int leavesChecked = 0;
+    ~Cursor() {
+      finish();
+    }
 
-    while (node != nullptr && leavesChecked < maxLeaves) {
-      node = ensureLoaded(node);
-      if (!node)
-        break;
+    bool valid() const {
+      return node || page;
+    }
 
-      for (const auto& pair : node->keys)
-        if (substring.empty() || pair.first.find(substring) != std::string::npos)
-          results.push_back(pair);
+    KeyView view() const {
+      return page ? tree->keyView(page, index) : tree->keyView(node, index);
+    }
 
-      leavesChecked++;
+    T key() const {
+      return toKey(view());
+    }
 
-      if (node->next)
-        node = ensureLoaded(node->next);
-      else
-        break;
+    void next() {
+      index++;
+      settle();
     }
 
-    return results;
+    // Pula n chaves; o restante de cada folha é pulado de uma vez.
+    void advance(size_t n) {
+      while (valid() && n > 0) {
+        size_t step = std::min(n, count() - index);
+        index += step;
+        n -= step;
+        settle();
+      }
+    }
+  };
+
+  // Chaves k com lo <= k < hi.
+  Cursor scan(const T& lo, const T& hi) const {
+    return openCursor(lo, true, hi);
+  }
+
+  // Chaves k com lo <= k, até o fim do índice.
+  Cursor scan(const T& lo) const {
+    return openCursor(lo, false, T());
+  }
+
+  // Títulos que começam com prefix, em ordem de (título, id).
+  template <typename U = T>
+  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value, Cursor>::type
+  scanPrefix(const std::string& prefix) const {
+    std::string upper = prefix;
+    while (!upper.empty() && (unsigned char) upper.back() == 0xff)
+      upper.pop_back();
+    if (upper.empty())
+      return scan({prefix, INT_MIN});
+
+    upper.back()++;
+    return scan({prefix, INT_MIN}, {upper, INT_MIN});
   }
 
   template <typename U = T>
   typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value,
                           std::vector<std::pair<std::string, int>>>::type
-  searchByPrefix(const std::string& prefix) const {
+  searchByPrefix(const std::string& prefix, size_t limit = SIZE_MAX) const {
     std::vector<std::pair<std::string, int>> results;
-
-    std::pair<std::string, int> searchKey = {prefix, 0};
-    auto path = findLeaf(searchKey);
-
-    if (path.empty())
-      return results;
-
-    auto leaf = path.back();
-    leaf = ensureLoaded(leaf);
-    if (!leaf)
-      return results;
-
-    for (const auto& pair : leaf->keys)
-      if (pair.first.find(prefix) != std::string::npos)
-        results.push_back(pair);
-
-    if (leaf->next) {
-      auto nextLeaf = ensureLoaded(leaf->next);
-      if (nextLeaf) {
-        for (const auto& pair : nextLeaf->keys)
-          if (pair.first.find(prefix) != std::string::npos)
-            results.push_back(pair);
-      }
-    }
-
+    for (Cursor cursor = scanPrefix(prefix); cursor.valid() && results.size() < limit; cursor.next())
+      results.push_back(cursor.key());
     return results;
   }
 
@@ -488,139 +1159,222 @@ public:
       return -1;
     }
 
-    file.write(reinterpret_cast<const char*>(&m), sizeof(int));
-
-    std::unordered_map<Node*, int> nodeIds;
-    int nextId = 0;
+    std::vector<Node*> order;
+    int nextPage = 1;
 
-    std::queue<Node*> nodeQueue;
-    std::unordered_set<Node*> visited;
-    nodeQueue.push(root);
-    visited.insert(root);
+    order.push_back(root);
+    for (size_t i = 0; i < order.size(); i++) {
+      Node* current = order[i];
+      current->nodeId = nextPage;
+      nextPage += pagesFor(nodeSize(current));
 
-    while (!nodeQueue.empty()) {
-      Node* current = nodeQueue.front();
-      nodeQueue.pop();
-
-      if (!current->isLeaf) {
-        for (auto child : current->children) {
-          if (visited.find(child) == visited.end()) {
-            nodeQueue.push(child);
-            visited.insert(child);
-          }
-        }
-      }
-
-      if (current->isLeaf && current->next && visited.find(current->next) == visited.end()) {
-        nodeQueue.push(current->next);
-        visited.insert(current->next);
-      }
+      if (!current->isLeaf)
+        for (auto child : current->children)
+          order.push_back(child);
     }
 
-    int totalNodes = visited.size();
-    file.write(reinterpret_cast<const char*>(&totalNodes), sizeof(int));
+    height = 1;
+    for (Node* node = root; !node->isLeaf; node = node->children[0])
+      height++;
+    totalNodes = order.size();
 
-    for (Node* node : visited)
-      saveNodeToFile(file, node, nodeIds, nextId);
+    writeFileHeader(file, root->nodeId, height, totalNodes, nextPage);
 
-    int rootId = nodeIds[root];
-    file.write(reinterpret_cast<const char*>(&rootId), sizeof(int));
+    std::vector<char> page;
+    std::vector<int32_t> childPages;
+    for (Node* node : order) {
+      childPages.clear();
+      for (auto child : node->children)
+        childPages.push_back(child->nodeId);
+      int32_t next = node->isLeaf && node->next ? node->next->nodeId : -1;
 
-    int numBlocks = (file.tellp() + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    file.close();
+      encodeNode(page, node->isLeaf, node->keys, childPages.data(), next);
+      file.write(page.data(), page.size());
+    }
 
-    return numBlocks;
+    file.close();
+    return nextPage;
   }
 
-  bool loadFromFile(const std::string& filename) {
-    fileName = filename;
-    isLazyMode = true;
-    nodeCache.clear();
-    nodePositions.clear();
-
-    std::ifstream file(filename, std::ios::binary);
+  // Constrói o índice direto no arquivo a partir de chaves ordenadas, sem
+  // montar a árvore em memória: as folhas são gravadas à medida que enchem
+  // e só os separadores de cada nível ficam em memória. Os nós são cheios
+  // por bytes (fillFactor de uma página), não por número de chaves, de modo
+  // que chaves curtas ou com prefixo comum aumentam o fan-out.
+  template <typename InputIt>
+  int bulkLoadToFile(const std::string& filename, InputIt first, InputIt last, double fillFactor = 1.0) {
+    std::ofstream file(filename, std::ios::binary);
     if (!file) {
-      std::cerr << "Erro: não foi possível abrir o arquivo " << filename << std::endl;
-      return false;
+      std::cerr << "Erro: não foi possível criar o arquivo " << filename << std::endl;
+      return -1;
     }
 
-    file.read(reinterpret_cast<char*>(&m), sizeof(int));
+    size_t budget = std::max<size_t>(BLOCK_SIZE / 2, std::min<size_t>(BLOCK_SIZE, BLOCK_SIZE * fillFactor));
+    int nextPage = 1;
+    int nodeCount = 0;
+    std::vector<char> page;
+    std::vector<T> separators;
+    std::vector<int32_t> pages;
+    T lastKey = T();
+
+    writeFileHeader(file, 0, 0, 0, 0);
+
+    auto writeNode = [&](bool isLeaf, const std::vector<T>& keys, const int32_t* childPages, bool hasNext) {
+      int32_t pageId = nextPage;
+      int count = pagesFor(encodedSize(isLeaf, keys));
+      encodeNode(page, isLeaf, keys, childPages, hasNext ? pageId + count : -1);
+      file.write(page.data(), page.size());
+      nextPage += count;
+      nodeCount++;
+      return pageId;
+    };
+
+    auto writeLeaf = [&](const std::vector<T>& keys, bool hasNext) {
+      separators.push_back(pages.empty() ? T() : get_separator(keys[0], lastKey));
+      if (!keys.empty())
+        lastKey = keys.back();
+      pages.push_back(writeNode(true, keys, nullptr, hasNext));
+    };
+
+    std::vector<T> prev, current;
+    size_t currentSize = sizeof(PageHeader);
+    bool hasPrev = false;
+    for (; first != last; ++first) {
+      size_t cost = keySize(current.empty() ? nullptr : &current.back(), *first);
+      if (!current.empty() && currentSize + cost > budget) {
+        if (hasPrev)
+          writeLeaf(prev, true);
+        prev.swap(current);
+        current.clear();
+        hasPrev = true;
+        currentSize = sizeof(PageHeader);
+        cost = keySize(nullptr, *first);
+      }
+      current.push_back(*first);
+      currentSize += cost;
+    }
 
-    int totalNodes;
-    file.read(reinterpret_cast<char*>(&totalNodes), sizeof(int));
+    if (hasPrev) {
+      bool keepLast = balanceTailBytes(prev, current, budget);
+      writeLeaf(prev, keepLast);
+      if (keepLast)
+        writeLeaf(current, false);
+    } else {
+      writeLeaf(current, false);
+    }
 
-    for (int i = 0; i < totalNodes; i++) {
-      std::streampos currentPos = file.tellg();
+    int levels = 1;
+    while (pages.size() > 1) {
+      std::vector<T> parentSeparators;
+      std::vector<int32_t> parentPages;
+      for (auto& group : packGroups(separators, budget)) {
+        std::vector<T> keys(separators.begin() + group.first + 1, separators.begin() + group.second);
+        parentPages.push_back(writeNode(false, keys, pages.data() + group.first, false));
+        parentSeparators.push_back(separators[group.first]);
+      }
 
-      int nodeId;
-      file.read(reinterpret_cast<char*>(&nodeId), sizeof(int));
+      pages.swap(parentPages);
+      separators.swap(parentSeparators);
+      levels++;
+    }
 
-      nodePositions[nodeId] = currentPos;
+    writeFileHeader(file, pages[0], levels, nodeCount, nextPage);
+    file.close();
+    return file ? nextPage : -1;
+  }
 
-      bool isLeaf;
-      file.read(reinterpret_cast<char*>(&isLeaf), sizeof(bool));
+  bool loadFromFile(const std::string& filename, int64_t cachePages = INDEX_CACHE_PAGES) {
+    release(lazyRoot);
+    lazyRoot = nullptr;
+    pool.clear();
+    pool.setCapacity(cachePages);
 
-      size_t keyCount;
-      file.read(reinterpret_cast<char*>(&keyCount), sizeof(size_t));
-      for (size_t j = 0; j < keyCount; j++)
-        skipKey(file);
+    fileName = filename;
+    isLazyMode = true;
+    if (lazyFd >= 0)
+      close(lazyFd);
 
-      if (!isLeaf) {
-        size_t childCount;
-        file.read(reinterpret_cast<char*>(&childCount), sizeof(size_t));
-        file.seekg(childCount * sizeof(int), std::ios::cur);
-      }
+    lazyFd = open(filename.c_str(), O_RDONLY);
+    std::vector<char> page(BLOCK_SIZE);
+    if (lazyFd < 0 || !readPages(0, 1, page.data())) {
+      std::cerr << "Erro: não foi possível abrir o arquivo " << filename << std::endl;
+      return false;
+    }
 
-      if (isLeaf)
-        file.seekg(sizeof(int), std::ios::cur);
+    FileHeader header;
+    memcpy(&header, page.data(), sizeof(FileHeader));
+    if (memcmp(header.magic, "BPT+", 4) != 0 || header.version != FILE_VERSION || header.keyType != keyType()) {
+      std::cerr << "Erro: formato de índice inválido em " << filename << std::endl;
+      return false;
     }
 
-    int rootId;
-    file.read(reinterpret_cast<char*>(&rootId), sizeof(int));
+    m = header.m;
+    height = header.height;
+    totalNodes = header.nodeCount;
 
-    root = loadNodeById(rootId);
-    if (!root) {
+    // A raiz fica fixada no pool enquanto o índice estiver aberto.
+    lazyRoot = fetch(header.rootPage);
+    if (!lazyRoot) {
       std::cerr << "Erro: não foi possível carregar nó raiz" << std::endl;
       return false;
     }
 
-    file.close();
     return true;
   }
 
-  template <typename U = T>
-  typename std::enable_if<std::is_same<U, int>::value>::type
-  skipKey(std::ifstream& file) const {
-    file.seekg(sizeof(int), std::ios::cur);
+  // Lê para o cache os nós dos primeiros `levels` níveis (raiz = nível 1),
+  // parando se o orçamento do pool se esgotar.
+  void preload(int levels) const {
+    if (!isLazyMode)
+      return;
+
+    std::vector<int32_t> level = {lazyRoot->pageId};
+    for (int depth = 1; depth <= levels && !level.empty(); depth++) {
+      std::vector<int32_t> below;
+      for (int32_t pageId : level) {
+        if (pool.getStats().residentPages >= pool.capacity())
+          return;
+
+        Page* page = fetch(pageId);
+        if (!page)
+          continue;
+        if (!isLeafNode(page))
+          for (size_t i = 0; i <= keyCount(page); i++)
+            below.push_back(childPage(page, i));
+        release(page);
+      }
+      level.swap(below);
+    }
   }
 
-  template <typename U = T>
-  typename std::enable_if<std::is_same<U, std::pair<std::string, int>>::value>::type
-  skipKey(std::ifstream& file) const {
-    size_t strLen;
-    file.read(reinterpret_cast<char*>(&strLen), sizeof(size_t));
-    file.seekg(strLen + sizeof(int), std::ios::cur);
+  // Acertos, faltas (nós lidos do arquivo) e despejos do buffer pool.
+  BufferPoolStats getCacheStats() const {
+    return pool.getStats();
   }
 
-  int getLoadedNodesCount() const {
-    return nodeCache.size();
+  int64_t getCacheCapacity() const {
+    return pool.capacity();
   }
 
-  int getTotalNodesCount() const {
-    return nodePositions.size();
+  void setCacheCapacity(int64_t pages) {
+    pool.setCapacity(pages);
   }
 
-  void clearCache() {
-    if (!isLazyMode)
-      return;
+  // Troca o kernel de busca dentro dos nós de chaves int (benchmarks).
+  void setKeySearch(KeySearchFn fn) {
+    keySearch = fn;
+  }
 
-    for (auto& pair : nodeCache)
-      if (pair.second && pair.second != root)
-        delete pair.second;
-    nodeCache.clear();
+  int getTotalNodesCount() const {
+    return totalNodes;
+  }
 
-    if (root)
-      nodeCache[root->nodeId] = root;
+  int getHeight() const {
+    return height;
+  }
+
+  void clearCache() {
+    pool.clear();
   }
 };
 
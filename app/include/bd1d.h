@@ -0,0 +1,136 @@
+#ifndef BD1D_H
+#define BD1D_H
+
+#include "iostats.h"
+#include <bits/stdc++.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Protocolo do bd1d sobre socket Unix: uma requisição por linha
+// ("findrec <id>", "seek1 <id>", "seek1 --from A [--to B] [--limit N]",
+// "seek2 [--offset N] [--limit N] <título>" ou "stats") e resposta
+// "<status> <contadores> <tamanho>\n" seguida de <tamanho> bytes com a mesma
+// saída que a ferramenta local imprimiria. Os contadores são os do
+// IoCounters da requisição, na ordem de formatCounters.
+#define BD1D_SOCKET "data/db/bd1d.sock"
+
+inline bool writeAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+inline std::string formatCounters(const IoCounters& counters) {
+  std::string text = std::to_string(counters.blocks) + " " + std::to_string(counters.bytes) + " " +
+                     std::to_string(counters.syscalls) + " " + std::to_string(counters.cacheHits) + " " +
+                     std::to_string(counters.cacheMisses);
+  for (int64_t nanos : counters.phaseNanos)
+    text += " " + std::to_string(nanos);
+  return text;
+}
+
+// Lê os contadores do começo de in; devolve false se faltar algum.
+inline bool parseCounters(std::istream& in, IoCounters& counters) {
+  in >> counters.blocks >> counters.bytes >> counters.syscalls >> counters.cacheHits >> counters.cacheMisses;
+  for (int64_t& nanos : counters.phaseNanos)
+    in >> nanos;
+  return !in.fail();
+}
+
+class Bd1Client {
+private:
+  int fd;
+  std::string buffer;
+
+  bool fill() {
+    char chunk[65536];
+    ssize_t n;
+    do
+      n = read(fd, chunk, sizeof(chunk));
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+      return false;
+    buffer.append(chunk, n);
+    return true;
+  }
+
+public:
+  Bd1Client() : fd(-1) {}
+
+  Bd1Client(const Bd1Client&) = delete;
+  Bd1Client& operator=(const Bd1Client&) = delete;
+
+  ~Bd1Client() {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  bool connect(const std::string& path) {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+      return false;
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+  }
+
+  bool query(const std::string& request, int& status, IoCounters& counters, std::string& output) {
+    std::string line = request + "\n";
+    if (!writeAll(fd, line.data(), line.size()))
+      return false;
+
+    size_t eol;
+    while ((eol = buffer.find('\n')) == std::string::npos)
+      if (!fill())
+        return false;
+
+    std::istringstream header(buffer.substr(0, eol));
+    size_t bytes;
+    if (!(header >> status) || !parseCounters(header, counters) || !(header >> bytes))
+      return false;
+    buffer.erase(0, eol + 1);
+
+    while (buffer.size() < bytes)
+      if (!fill())
+        return false;
+
+    output = buffer.substr(0, bytes);
+    buffer.erase(0, bytes);
+    return true;
+  }
+};
+
+// Modo cliente das ferramentas: envia a requisição ao bd1d e imprime a
+// resposta no mesmo formato da execução local, com os contadores de E/S do
+// servidor e o tempo visto pelo cliente.
+int runRemote(const std::string& socketPath, const char* tool, const std::string& request, bool showMillis = true) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  Bd1Client client;
+  int status;
+  IoCounters counters;
+  std::string output;
+  if (!client.connect(socketPath) || !client.query(request, status, counters, output)) {
+    std::cerr << "Erro: não foi possível consultar o bd1d em " << socketPath << std::endl;
+    return 1;
+  }
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+  printIoSummary(std::cout, tool, t.count(), counters, showMillis);
+  std::cout << output;
+  return status;
+}
+
+#endif
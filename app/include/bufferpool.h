@@ -0,0 +1,226 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include "iostats.h"
+#include <bits/stdc++.h>
+
+#define BUFFERPOOL_SHARDS 16
+
+struct BufferPoolStats {
+  int64_t hits;
+  int64_t misses;
+  int64_t evictions;
+  int64_t residentPages;
+};
+
+// Cache de nós de índice com orçamento fixo em páginas e substituição
+// CLOCK. Cada quadro guarda um nó já decodificado e imutável; quadros
+// fixados (pin) não são despejados. Se todos estiverem fixados o orçamento é
+// excedido temporariamente em vez de falhar a leitura.
+//
+// As páginas são repartidas em até BUFFERPOOL_SHARDS fatias (nunca mais
+// fatias que páginas de orçamento), cada uma com seu mutex, relógio e parte
+// do orçamento, para que várias threads leiam o mesmo índice sem disputar uma
+// trava única.
+template <typename NodeT>
+class BufferPool {
+private:
+  struct Frame {
+    int32_t page;
+    NodeT* node;
+    int pages;
+    int pinCount;
+    bool referenced;
+  };
+
+  struct Shard {
+    mutable std::mutex lock;
+    std::vector<Frame> frames;
+    std::unordered_map<int32_t, size_t> frameOf;
+    std::vector<size_t> freeFrames;
+    size_t hand = 0;
+    int64_t capacityPages = 1;
+    BufferPoolStats stats = {};
+
+    void evict(size_t f) {
+      Frame& frame = frames[f];
+      frameOf.erase(frame.page);
+      delete frame.node;
+      stats.residentPages -= frame.pages;
+      stats.evictions++;
+      frame.node = nullptr;
+      freeFrames.push_back(f);
+    }
+
+    // Avança o ponteiro do relógio até liberar `pages` páginas ou dar duas
+    // voltas completas sem achar vítima.
+    void makeRoom(int pages) {
+      size_t steps = 2 * frames.size();
+      while (!frames.empty() && stats.residentPages + pages > capacityPages && steps-- > 0) {
+        hand = (hand + 1) % frames.size();
+        Frame& frame = frames[hand];
+        if (!frame.node || frame.pinCount > 0)
+          continue;
+        if (frame.referenced)
+          frame.referenced = false;
+        else
+          evict(hand);
+      }
+    }
+  };
+
+  std::vector<Shard> shards;
+  size_t shardCount;
+  int64_t capacityPages;
+
+  Shard& shardOf(int32_t page) {
+    return shards[(uint32_t) page % shardCount];
+  }
+
+  // Redistribui os quadros (fixados inclusive) entre count fatias.
+  void reshard(size_t count) {
+    std::vector<Frame> all;
+    for (auto& shard : shards) {
+      for (auto& frame : shard.frames)
+        if (frame.node)
+          all.push_back(frame);
+      shard.frames.clear();
+      shard.frameOf.clear();
+      shard.freeFrames.clear();
+      shard.hand = 0;
+      shard.stats.residentPages = 0;
+    }
+
+    shardCount = count;
+    for (const Frame& frame : all) {
+      Shard& shard = shardOf(frame.page);
+      shard.frameOf[frame.page] = shard.frames.size();
+      shard.frames.push_back(frame);
+      shard.stats.residentPages += frame.pages;
+    }
+  }
+
+public:
+  BufferPool(int64_t capacityPages) : shards(BUFFERPOOL_SHARDS), shardCount(BUFFERPOOL_SHARDS) {
+    setCapacity(capacityPages);
+  }
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  ~BufferPool() {
+    for (auto& shard : shards)
+      for (auto& frame : shard.frames)
+        delete frame.node;
+  }
+
+  // Devolve o nó da página fixado, ou nullptr se ele não está no cache.
+  NodeT* pin(int32_t page) {
+    Shard& shard = shardOf(page);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.frameOf.find(page);
+    if (it == shard.frameOf.end())
+      return nullptr;
+
+    Frame& frame = shard.frames[it->second];
+    frame.pinCount++;
+    frame.referenced = true;
+    shard.stats.hits++;
+    ioStats().addCacheLookup(true);
+    return frame.node;
+  }
+
+  // Coloca no cache um nó recém-lido e o devolve fixado; a falta é contada
+  // aqui (também no ioStats()), só por quem instala a página. O pool passa a ser o dono do nó. Se
+  // outra thread já colocou a mesma página, o nó novo é descartado e o
+  // existente devolvido.
+  NodeT* add(int32_t page, NodeT* node, int pages) {
+    Shard& shard = shardOf(page);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.frameOf.find(page);
+    if (it != shard.frameOf.end()) {
+      delete node;
+      Frame& frame = shard.frames[it->second];
+      frame.pinCount++;
+      frame.referenced = true;
+      return frame.node;
+    }
+
+    shard.makeRoom(pages);
+
+    size_t f;
+    if (shard.freeFrames.empty()) {
+      f = shard.frames.size();
+      shard.frames.push_back(Frame());
+    } else {
+      f = shard.freeFrames.back();
+      shard.freeFrames.pop_back();
+    }
+
+    shard.frames[f] = {page, node, pages, 1, true};
+    shard.frameOf[page] = f;
+    shard.stats.residentPages += pages;
+    shard.stats.misses++;
+    ioStats().addCacheLookup(false);
+    return node;
+  }
+
+  void unpin(int32_t page) {
+    Shard& shard = shardOf(page);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.frameOf.find(page);
+    if (it != shard.frameOf.end() && shard.frames[it->second].pinCount > 0)
+      shard.frames[it->second].pinCount--;
+  }
+
+  // Não pode ser chamado com leituras em andamento em outras threads.
+  void setCapacity(int64_t pages) {
+    capacityPages = std::max<int64_t>(1, pages);
+    size_t count = std::min<int64_t>(BUFFERPOOL_SHARDS, capacityPages);
+    if (count != shardCount)
+      reshard(count);
+    for (size_t i = 0; i < shardCount; i++) {
+      std::lock_guard<std::mutex> guard(shards[i].lock);
+      shards[i].capacityPages = capacityPages / shardCount + ((int64_t) i < capacityPages % (int64_t) shardCount);
+      shards[i].makeRoom(0);
+    }
+  }
+
+  int64_t capacity() const {
+    return capacityPages;
+  }
+
+  // Descarta todos os quadros não fixados.
+  void clear() {
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      for (size_t f = 0; f < shard.frames.size(); f++)
+        if (shard.frames[f].node && shard.frames[f].pinCount == 0)
+          shard.evict(f);
+    }
+  }
+
+  BufferPoolStats getStats() const {
+    BufferPoolStats total = {};
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      total.hits += shard.stats.hits;
+      total.misses += shard.stats.misses;
+      total.evictions += shard.stats.evictions;
+      total.residentPages += shard.stats.residentPages;
+    }
+    return total;
+  }
+
+  void resetStats() {
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      shard.stats.hits = shard.stats.misses = shard.stats.evictions = 0;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "iostats.h"
+#include "record.h"
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Colunas do banco para varreduras analíticas, gravadas pelo upload ao lado
+// do hash.bin, uma por arquivo e na ordem do CSV (a linha i de todas as
+// colunas é o mesmo artigo): col_id.bin, col_year.bin e col_cites.bin
+// (int32), col_datetime.bin (int64) e, para título e autores, col_X.off
+// (rows + 1 offsets uint64) com col_X.bin (os textos concatenados, sem
+// terminador). Cada arquivo é um cabeçalho de COLUMN_HEADER_SIZE bytes
+// seguido dos valores, então os valores ficam alinhados a 64 bytes no mmap
+// e uma varredura lê só os bytes das colunas que usa.
+enum ColumnType { COLUMN_INT32 = 1, COLUMN_INT64 = 2, COLUMN_OFFSETS = 3, COLUMN_BYTES = 4 };
+
+struct ColumnHeader {
+  char magic[4];
+  int32_t version;
+  int32_t type;
+  int32_t width;
+  int64_t count;
+  int64_t min;
+  int64_t max;
+};
+
+#define COLUMN_FILE_VERSION 1
+#define COLUMN_HEADER_SIZE 64
+#define COLUMN_WRITE_BUFFER (256 << 10)
+
+inline int columnWidth(ColumnType type) {
+  return type == COLUMN_INT32 ? 4 : type == COLUMN_BYTES ? 1 : 8;
+}
+
+class ColumnWriter {
+private:
+  std::ofstream out;
+  ColumnHeader header;
+  std::vector<char> buffer;
+
+  void flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+
+public:
+  bool open(const std::string& path, ColumnType type) {
+    out.open(path, std::ios::binary);
+    if (!out)
+      return false;
+
+    header = {};
+    memcpy(header.magic, "COL+", 4);
+    header.version = COLUMN_FILE_VERSION;
+    header.type = type;
+    header.width = columnWidth(type);
+    header.min = INT64_MAX;
+    header.max = INT64_MIN;
+    out.write(std::string(COLUMN_HEADER_SIZE, '\0').data(), COLUMN_HEADER_SIZE);
+    buffer.reserve(COLUMN_WRITE_BUFFER);
+    return true;
+  }
+
+  // Valor de uma coluna numérica; min e max vão para o cabeçalho.
+  template <typename V>
+  void add(V value) {
+    header.min = std::min<int64_t>(header.min, value);
+    header.max = std::max<int64_t>(header.max, value);
+    append(&value, sizeof(V));
+    header.count++;
+  }
+
+  // Bytes de uma coluna COLUMN_BYTES.
+  void addBytes(const char* data, size_t size) {
+    append(data, size);
+    header.count += size;
+  }
+
+  void append(const void* data, size_t size) {
+    if (buffer.size() + size > COLUMN_WRITE_BUFFER)
+      flush();
+    buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+  }
+
+  // Devolve o tamanho do arquivo em bytes, ou -1 em erro.
+  int64_t close() {
+    flush();
+    if (header.count == 0 || header.type == COLUMN_BYTES)
+      header.min = header.max = 0;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(ColumnHeader));
+    out.close();
+    return out ? COLUMN_HEADER_SIZE + header.count * header.width : -1;
+  }
+};
+
+// Todas as colunas de um banco; add() recebe os registros na ordem do CSV.
+class ColumnSetWriter {
+private:
+  ColumnWriter id, year, cites, dateTime, titleOffsets, titles, authorOffsets, authors;
+  uint64_t titleEnd, authorEnd;
+
+public:
+  // Memória dos buffers de escrita, reservada em open().
+  static size_t bufferBytes() {
+    return 8 * COLUMN_WRITE_BUFFER;
+  }
+
+  bool open(const std::string& prefix) {
+    titleEnd = authorEnd = 0;
+    bool ok = id.open(prefix + "id.bin", COLUMN_INT32) && year.open(prefix + "year.bin", COLUMN_INT32) &&
+              cites.open(prefix + "cites.bin", COLUMN_INT32) &&
+              dateTime.open(prefix + "datetime.bin", COLUMN_INT64) &&
+              titleOffsets.open(prefix + "title.off", COLUMN_OFFSETS) &&
+              titles.open(prefix + "title.bin", COLUMN_BYTES) &&
+              authorOffsets.open(prefix + "authors.off", COLUMN_OFFSETS) &&
+              authors.open(prefix + "authors.bin", COLUMN_BYTES);
+    if (ok) {
+      titleOffsets.add<uint64_t>(0);
+      authorOffsets.add<uint64_t>(0);
+    }
+    return ok;
+  }
+
+  void add(const Record& rec) {
+    id.add<int32_t>(rec.id);
+    year.add<int32_t>(rec.year);
+    cites.add<int32_t>(rec.cites);
+    dateTime.add<int64_t>(rec.dateTime);
+
+    size_t length = strnlen(rec.title, sizeof(rec.title));
+    titles.addBytes(rec.title, length);
+    titleOffsets.add<uint64_t>(titleEnd += length);
+
+    length = strnlen(rec.authors, sizeof(rec.authors));
+    authors.addBytes(rec.authors, length);
+    authorOffsets.add<uint64_t>(authorEnd += length);
+  }
+
+  // Devolve o número de blocos escritos em todas as colunas, ou -1 em erro.
+  int close() {
+    int blocks = 0;
+    bool ok = true;
+    for (ColumnWriter* column : {&id, &year, &cites, &dateTime, &titleOffsets, &titles, &authorOffsets, &authors}) {
+      int64_t bytes = column->close();
+      ok &= bytes >= 0;
+      blocks += (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+    return ok ? blocks : -1;
+  }
+};
+
+// Leitura de uma coluna via mmap, para varredura sequencial. touch() conta
+// no ioStats() os bytes de um intervalo de linhas, pois o acesso direto ao
+// mapeamento não passa por nenhuma leitura explícita.
+class Column {
+private:
+  int fd;
+  const char* data;
+  size_t size;
+  ColumnHeader header;
+
+public:
+  Column() : fd(-1), data(nullptr), size(0), header() {}
+
+  Column(const Column&) = delete;
+  Column& operator=(const Column&) = delete;
+
+  ~Column() {
+    close();
+  }
+
+  bool open(const std::string& path, ColumnType type, bool populate = false) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < COLUMN_HEADER_SIZE) {
+      close();
+      return false;
+    }
+    size = st.st_size;
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED | (populate ? MAP_POPULATE : 0), fd, 0);
+    if (addr == MAP_FAILED) {
+      close();
+      return false;
+    }
+    data = static_cast<const char*>(addr);
+    madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+
+    memcpy(&header, data, sizeof(ColumnHeader));
+    if (memcmp(header.magic, "COL+", 4) != 0 || header.version != COLUMN_FILE_VERSION || header.type != type ||
+        header.width != columnWidth(type) || header.count < 0 ||
+        COLUMN_HEADER_SIZE + (size_t) header.count * header.width > size) {
+      close();
+      return false;
+    }
+    ioStats().addRead(fd, 0, COLUMN_HEADER_SIZE);
+    return true;
+  }
+
+  void close() {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    data = nullptr;
+    size = 0;
+  }
+
+  bool isOpen() const {
+    return data != nullptr;
+  }
+
+  int64_t count() const {
+    return header.count;
+  }
+
+  int64_t min() const {
+    return header.min;
+  }
+
+  int64_t max() const {
+    return header.max;
+  }
+
+  template <typename V>
+  const V* values() const {
+    return reinterpret_cast<const V*>(data + COLUMN_HEADER_SIZE);
+  }
+
+  void touch(size_t first, size_t count) const {
+    ioStats().addRead(fd, COLUMN_HEADER_SIZE + first * header.width, count * header.width);
+  }
+};
+
+// Coluna de texto: offsets e bytes. at(i) é o texto da linha i.
+class TextColumn {
+private:
+  Column offsets;
+  Column bytes;
+
+public:
+  bool open(const std::string& prefix, bool populate = false) {
+    return offsets.open(prefix + ".off", COLUMN_OFFSETS, populate) &&
+           bytes.open(prefix + ".bin", COLUMN_BYTES, populate) && offsets.count() > 0 &&
+           offsets.values<uint64_t>()[offsets.count() - 1] <= (uint64_t) bytes.count();
+  }
+
+  int64_t count() const {
+    return offsets.count() - 1;
+  }
+
+  std::string_view at(size_t i) const {
+    const uint64_t* offset = offsets.values<uint64_t>();
+    return std::string_view(bytes.values<char>() + offset[i], offset[i + 1] - offset[i]);
+  }
+
+  void touch(size_t first, size_t count) const {
+    const uint64_t* offset = offsets.values<uint64_t>();
+    offsets.touch(first, count + 1);
+    bytes.touch(offset[first], offset[first + count] - offset[first]);
+  }
+};
+
+#endif
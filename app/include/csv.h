@@ -0,0 +1,187 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <bits/stdc++.h>
+#include <immintrin.h>
+
+#define CSV_MAX_FIELDS 16
+
+struct CsvRow {
+  std::string_view fields[CSV_MAX_FIELDS];
+  int count;
+};
+
+typedef uint64_t (*CsvMaskFn)(const char* p);
+
+inline uint64_t csvMaskScalar(const char* p) {
+  uint64_t mask = 0;
+  for (int i = 0; i < 64; i++)
+    if (p[i] == ';' || p[i] == '"' || p[i] == '\n')
+      mask |= 1ULL << i;
+  return mask;
+}
+
+inline uint64_t csvMaskSSE2(const char* p) {
+  const __m128i semicolon = _mm_set1_epi8(';'), quote = _mm_set1_epi8('"'), newline = _mm_set1_epi8('\n');
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, semicolon), _mm_cmpeq_epi8(v, quote)),
+                               _mm_cmpeq_epi8(v, newline));
+    mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(hit) << (16 * i);
+  }
+  return mask;
+}
+
+__attribute__((target("avx2"))) inline uint64_t csvMaskAVX2(const char* p) {
+  const __m256i semicolon = _mm256_set1_epi8(';'), quote = _mm256_set1_epi8('"'), newline = _mm256_set1_epi8('\n');
+  uint64_t mask = 0;
+  for (int i = 0; i < 2; i++) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+    __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, semicolon), _mm256_cmpeq_epi8(v, quote)),
+                                  _mm256_cmpeq_epi8(v, newline));
+    mask |= (uint64_t) (uint32_t) _mm256_movemask_epi8(hit) << (32 * i);
+  }
+  return mask;
+}
+
+inline CsvMaskFn csvDefaultMask() {
+  static CsvMaskFn fn = __builtin_cpu_supports("avx2") ? csvMaskAVX2 : csvMaskSSE2;
+  return fn;
+}
+
+inline bool csvSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Tokenizador do artigo.csv com a mesma semântica de upload::parse + trim:
+// '\n' encerra o registro, cada '"' alterna o modo entre aspas (e é
+// descartada), ';' fora de aspas separa campos e os campos saem sem espaços
+// nas pontas. Os delimitadores são localizados 64 bytes por vez com
+// SSE2/AVX2; os campos são string_views para dentro do próprio buffer, que
+// só é reescrito quando um campo tem aspas no meio do texto.
+class CsvTokenizer {
+private:
+  CsvMaskFn maskFn;
+
+  struct Scanner {
+    const char* base;
+    const char* end;
+    uint64_t mask;
+    CsvMaskFn fn;
+
+    void load() {
+      if (end - base >= 64) {
+        mask = fn(base);
+      } else {
+        char tail[64] = {};
+        memcpy(tail, base, end - base);
+        mask = fn(tail) & ((1ULL << (end - base)) - 1);
+      }
+    }
+
+    const char* next() {
+      while (mask == 0) {
+        base += 64;
+        if (base >= end)
+          return end;
+        load();
+      }
+      int i = __builtin_ctzll(mask);
+      mask &= mask - 1;
+      return base + i;
+    }
+  };
+
+  static std::string_view trim(const char* begin, const char* end) {
+    while (begin < end && csvSpace(*begin))
+      begin++;
+    while (end > begin && csvSpace(end[-1]))
+      end--;
+    return std::string_view(begin, end - begin);
+  }
+
+  static bool blank(const char* begin, const char* end) {
+    for (; begin < end; begin++)
+      if (!csvSpace(*begin))
+        return false;
+    return true;
+  }
+
+  static std::string_view field(char* begin, char* end, int quotes, const char* firstQuote, const char* lastQuote) {
+    if (quotes == 0)
+      return trim(begin, end);
+
+    if (quotes == 2 && blank(begin, firstQuote) && blank(lastQuote + 1, end))
+      return trim(firstQuote + 1, lastQuote);
+
+    char* w = begin;
+    for (char* r = begin; r < end; r++)
+      if (*r != '"')
+        *w++ = *r;
+    return trim(begin, w);
+  }
+
+public:
+  CsvTokenizer(CsvMaskFn maskFn = csvDefaultMask()) : maskFn(maskFn) {}
+
+  // Chama fn(row) para cada linha completa de [data, data + size) e devolve
+  // quantos bytes foram consumidos. Com final = true a última linha sem '\n'
+  // também é entregue.
+  template <typename Fn>
+  size_t tokenize(char* data, size_t size, bool final, Fn&& fn) const {
+    char* end = data + size;
+    Scanner scanner = {data, end, 0, maskFn};
+    if (size > 0)
+      scanner.load();
+
+    CsvRow row;
+    row.count = 0;
+    char* lineStart = data;
+    char* fieldStart = data;
+    bool inQuotes = false;
+    int quotes = 0;
+    const char* firstQuote = nullptr;
+    const char* lastQuote = nullptr;
+
+    auto endField = [&](char* p) {
+      if (row.count < CSV_MAX_FIELDS)
+        row.fields[row.count] = field(fieldStart, p, quotes, firstQuote, lastQuote);
+      row.count++;
+      fieldStart = p + 1;
+      quotes = 0;
+    };
+
+    for (;;) {
+      char* p = const_cast<char*>(scanner.next());
+      if (p == end) {
+        if (final && lineStart < end) {
+          endField(end);
+          fn(row);
+          lineStart = end;
+        }
+        break;
+      }
+
+      if (*p == '"') {
+        inQuotes = !inQuotes;
+        if (quotes++ == 0)
+          firstQuote = p;
+        lastQuote = p;
+      } else if (*p == ';') {
+        if (!inQuotes)
+          endField(p);
+      } else {
+        endField(p);
+        fn(row);
+        row.count = 0;
+        inQuotes = false;
+        lineStart = p + 1;
+      }
+    }
+
+    return lineStart - data;
+  }
+};
+
+#endif
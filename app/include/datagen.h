@@ -0,0 +1,175 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <bits/stdc++.h>
+
+// Gerador determinístico de linhas no formato do artigo.csv: sete campos
+// entre aspas separados por ';' (id, título, ano, autores, citações,
+// atualização, snippet). Para a mesma semente a saída é idêntica em qualquer
+// máquina: só usa aritmética inteira e um splitmix64 próprio, nada das
+// distribuições da biblioteca padrão, cujo resultado depende da
+// implementação.
+//
+// As palavras seguem uma Zipf sobre um vocabulário fixo, como texto real;
+// títulos têm em geral 6 a 14 palavras e snippets cerca de 30 a 40, com
+// cauda até o tamanho do campo; alguns snippets são vazios e alguns títulos
+// têm aspas e ';' escapados.
+#define DATAGEN_VOCABULARY 4096
+
+class ArticleGenerator {
+private:
+  uint64_t state;
+  int64_t nextId;
+  std::vector<std::string> words;
+  std::vector<uint64_t> wordCdf;
+  std::vector<std::string> authors;
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // Inteiro uniforme em [lo, hi].
+  int64_t uniform(int64_t lo, int64_t hi) {
+    return lo + (int64_t) (next() % (uint64_t) (hi - lo + 1));
+  }
+
+  // Soma de quatro uniformes: aproximadamente normal em torno de mean, sem
+  // ponto flutuante.
+  int64_t bell(int64_t mean, int64_t spread) {
+    int64_t sum = 0;
+    for (int i = 0; i < 4; i++)
+      sum += uniform(-spread, spread);
+    return mean + sum / 2;
+  }
+
+  const std::string& word() {
+    uint64_t r = next() % wordCdf.back();
+    return words[std::upper_bound(wordCdf.begin(), wordCdf.end(), r) - wordCdf.begin()];
+  }
+
+  void appendWords(std::string& out, int count, size_t maxBytes) {
+    for (int i = 0; i < count; i++) {
+      const std::string& w = word();
+      if (out.size() + w.size() + 1 > maxBytes)
+        break;
+      if (!out.empty())
+        out += ' ';
+      out += w;
+    }
+  }
+
+  static void appendQuoted(std::string& line, const std::string& field) {
+    line += '"';
+    for (char c : field) {
+      if (c == '"')
+        line += '"';
+      line += c;
+    }
+    line += '"';
+  }
+
+public:
+  ArticleGenerator(uint64_t seed, int64_t firstId = 1) : state(seed), nextId(firstId) {
+    static const char* syllables[] = {"da", "ta", "ne", "ro", "mo", "de", "li", "sa", "ti", "on", "al", "ing",
+                                      "com", "pu", "tion", "ver", "sys", "net", "ba", "se", "in", "dex", "gra",
+                                      "ph", "ar", "chi", "tec", "ture", "lo", "gic", "mi", "cro", "sca", "le"};
+    static const char* common[] = {"of", "the", "and", "for", "a", "in", "on", "with", "to", "using",
+                                   "data", "network", "learning", "system", "analysis", "3D", "design",
+                                   "model", "query", "database", "neural", "graph", "study", "case"};
+
+    // Vocabulário: palavras comuns primeiro (as mais frequentes na Zipf) e
+    // depois combinações de sílabas, derivadas de uma semente fixa para
+    // serem as mesmas qualquer que seja seed.
+    for (const char* w : common)
+      words.push_back(w);
+    uint64_t saved = state;
+    state = 0x5eed;
+    std::unordered_set<std::string> seen(words.begin(), words.end());
+    while (words.size() < DATAGEN_VOCABULARY) {
+      std::string w;
+      int parts = uniform(2, 4);
+      for (int i = 0; i < parts; i++)
+        w += syllables[uniform(0, sizeof(syllables) / sizeof(*syllables) - 1)];
+      if (seen.insert(w).second)
+        words.push_back(w);
+    }
+    state = saved;
+
+    // Zipf com s = 1: peso da posição k proporcional a 1/k, em inteiros.
+    uint64_t total = 0;
+    for (size_t k = 1; k <= words.size(); k++)
+      wordCdf.push_back(total += (1ull << 32) / k);
+
+    static const char* first[] = {"Ana", "Doug", "Li", "Maria", "John", "Wei", "Carlos", "Yuki", "Anamary", "Pedro",
+                                  "Sara", "Ahmed", "Elena", "Raj", "Joao", "Chen"};
+    static const char* last[] = {"Silva", "Bowman", "Wei", "Santos", "Smith", "Zhang", "Leal", "Tanaka", "Kumar",
+                                 "Souza", "Garcia", "Muller", "Rossi", "Kim", "Nguyen", "Costa"};
+    for (const char* f : first)
+      for (const char* l : last)
+        authors.push_back(std::string(f) + " " + l);
+  }
+
+  // Acrescenta a line a próxima linha (com '\n').
+  void nextLine(std::string& line) {
+    int64_t id = nextId++;
+
+    std::string title;
+    appendWords(title, std::max<int64_t>(2, bell(10, 6)), 290);
+    if (!title.empty())
+      title[0] = toupper((unsigned char) title[0]);
+    uint64_t quirk = next() % 100;
+    if (quirk < 3)
+      title = "\"" + title + "\"";
+    else if (quirk < 5)
+      title += "; a case study";
+    title += '.';
+
+    // Mais publicações recentes: o ano é o máximo de dois sorteios.
+    int64_t year = std::max(uniform(1950, 2016), uniform(1950, 2016));
+
+    std::string names;
+    int authorCount = std::min<int64_t>(uniform(1, 3), uniform(1, 8));
+    for (int i = 0; i < authorCount; i++) {
+      if (i)
+        names += '|';
+      names += authors[next() % authors.size()];
+    }
+
+    // Citações com cauda longa: metade até 10, poucas acima de 1000.
+    int64_t cites = uniform(0, 10);
+    for (int i = 0; i < 3 && next() % 3 == 0; i++)
+      cites = cites * uniform(2, 12) + uniform(0, 9);
+
+    char updated[24];
+    snprintf(updated, sizeof(updated), "2016-%02d-%02d %02d:%02d:%02d", (int) uniform(1, 12), (int) uniform(1, 28),
+             (int) uniform(0, 23), (int) uniform(0, 59), (int) uniform(0, 59));
+
+    std::string snippet;
+    if (next() % 100 >= 4) {
+      int count = std::max<int64_t>(1, bell(36, 16));
+      if (next() % 10 == 0)
+        count *= 4;
+      appendWords(snippet, count, 1000);
+    }
+
+    appendQuoted(line, std::to_string(id));
+    line += ';';
+    appendQuoted(line, title);
+    line += ';';
+    appendQuoted(line, std::to_string(year));
+    line += ';';
+    appendQuoted(line, names);
+    line += ';';
+    appendQuoted(line, std::to_string(cites));
+    line += ';';
+    appendQuoted(line, updated);
+    line += ';';
+    appendQuoted(line, snippet);
+    line += '\n';
+  }
+};
+
+#endif
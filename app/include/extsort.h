@@ -0,0 +1,248 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <bits/stdc++.h>
+
+inline size_t sortKeyBytes(const int& key) {
+  return sizeof(int);
+}
+
+inline size_t sortKeyBytes(const uint64_t& key) {
+  return sizeof(uint64_t);
+}
+
+inline size_t sortKeyBytes(const std::pair<int, int>& key) {
+  return sizeof(key);
+}
+
+inline size_t sortKeyBytes(const std::pair<std::string, int>& key) {
+  return sizeof(key) + key.first.capacity();
+}
+
+inline void writeSortKey(std::ostream& out, const int& key) {
+  out.write(reinterpret_cast<const char*>(&key), sizeof(int));
+}
+
+inline void writeSortKey(std::ostream& out, const uint64_t& key) {
+  out.write(reinterpret_cast<const char*>(&key), sizeof(uint64_t));
+}
+
+inline void writeSortKey(std::ostream& out, const std::pair<int, int>& key) {
+  out.write(reinterpret_cast<const char*>(&key.first), sizeof(int));
+  out.write(reinterpret_cast<const char*>(&key.second), sizeof(int));
+}
+
+inline void writeSortKey(std::ostream& out, const std::pair<std::string, int>& key) {
+  uint32_t strLen = key.first.length();
+  out.write(reinterpret_cast<const char*>(&strLen), sizeof(uint32_t));
+  out.write(key.first.data(), strLen);
+  out.write(reinterpret_cast<const char*>(&key.second), sizeof(int));
+}
+
+inline bool readSortKey(std::istream& in, int& key) {
+  return (bool) in.read(reinterpret_cast<char*>(&key), sizeof(int));
+}
+
+inline bool readSortKey(std::istream& in, uint64_t& key) {
+  return (bool) in.read(reinterpret_cast<char*>(&key), sizeof(uint64_t));
+}
+
+inline bool readSortKey(std::istream& in, std::pair<int, int>& key) {
+  in.read(reinterpret_cast<char*>(&key.first), sizeof(int));
+  return (bool) in.read(reinterpret_cast<char*>(&key.second), sizeof(int));
+}
+
+inline bool readSortKey(std::istream& in, std::pair<std::string, int>& key) {
+  uint32_t strLen;
+  if (!in.read(reinterpret_cast<char*>(&strLen), sizeof(uint32_t)))
+    return false;
+  key.first.resize(strLen);
+  in.read(&key.first[0], strLen);
+  return (bool) in.read(reinterpret_cast<char*>(&key.second), sizeof(int));
+}
+
+template <typename T>
+void sortKeys(std::vector<T>& keys) {
+  std::sort(keys.begin(), keys.end());
+}
+
+// Chaves de 64 bits (os pares trigrama/id do text.bin) são ordenadas por
+// radix LSD, um passo por byte, pulando os bytes iguais em todas as chaves.
+inline void sortKeys(std::vector<uint64_t>& keys) {
+  if (keys.size() < 2)
+    return;
+
+  std::vector<std::array<size_t, 256>> count(8);
+  for (uint64_t key : keys)
+    for (int b = 0; b < 8; b++)
+      count[b][key >> (8 * b) & 0xff]++;
+
+  std::vector<uint64_t> tmp(keys.size());
+  for (int b = 0; b < 8; b++) {
+    if (count[b][keys[0] >> (8 * b) & 0xff] == keys.size())
+      continue;
+
+    size_t offset = 0;
+    for (auto& c : count[b]) {
+      size_t n = c;
+      c = offset;
+      offset += n;
+    }
+    for (uint64_t key : keys)
+      tmp[count[b][key >> (8 * b) & 0xff]++] = key;
+    keys.swap(tmp);
+  }
+}
+
+// Ordena chaves em memória até memLimit bytes; acima disso grava runs
+// ordenadas em disco e as intercala (k-way merge) na iteração.
+template <typename T>
+class ExternalSorter {
+private:
+  struct Run {
+    std::ifstream in;
+    T head;
+  };
+
+  struct RunGreater {
+    const std::vector<Run>* runs;
+    bool operator()(int a, int b) const {
+      return (*runs)[b].head < (*runs)[a].head;
+    }
+  };
+
+  std::string tmpPrefix;
+  size_t memLimit;
+  size_t memUsed;
+  size_t count;
+  std::vector<T> buffer;
+  std::vector<std::string> runPaths;
+  std::vector<Run> runs;
+  std::priority_queue<int, std::vector<int>, RunGreater> heap;
+  size_t bufferPos;
+
+  void spill() {
+    sortKeys(buffer);
+    std::string path = tmpPrefix + "." + std::to_string(runPaths.size()) + ".run";
+    std::ofstream out(path, std::ios::binary);
+    for (const auto& key : buffer)
+      writeSortKey(out, key);
+    runPaths.push_back(path);
+    buffer.clear();
+    buffer.shrink_to_fit();
+    memUsed = 0;
+  }
+
+  bool next(T& key) {
+    if (runPaths.empty()) {
+      if (bufferPos >= buffer.size())
+        return false;
+      key = std::move(buffer[bufferPos++]);
+      return true;
+    }
+
+    if (heap.empty())
+      return false;
+
+    int i = heap.top();
+    heap.pop();
+    key = std::move(runs[i].head);
+    if (readSortKey(runs[i].in, runs[i].head))
+      heap.push(i);
+    return true;
+  }
+
+public:
+  class iterator {
+  private:
+    ExternalSorter* sorter;
+    T current;
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    iterator(ExternalSorter* sorter = nullptr) : sorter(sorter) {
+      ++*this;
+    }
+
+    const T& operator*() const {
+      return current;
+    }
+
+    iterator& operator++() {
+      if (sorter && !sorter->next(current))
+        sorter = nullptr;
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const {
+      return sorter == other.sorter;
+    }
+
+    bool operator!=(const iterator& other) const {
+      return sorter != other.sorter;
+    }
+  };
+
+  ExternalSorter(const std::string& tmpPrefix, size_t memLimit)
+      : tmpPrefix(tmpPrefix), memLimit(memLimit), memUsed(0), count(0),
+        heap(RunGreater{&runs}), bufferPos(0) {}
+
+  ~ExternalSorter() {
+    runs.clear();
+    for (const auto& path : runPaths)
+      std::remove(path.c_str());
+  }
+
+  // O buffer é reservado para memLimit bytes de chaves de uma vez: um
+  // vector que dobra chegaria a 3x o conteúdo durante a cópia. Só as
+  // páginas já preenchidas ocupam memória.
+  void add(const T& key) {
+    if (buffer.capacity() == 0)
+      buffer.reserve(memLimit / sizeof(T) + 1);
+    memUsed += sortKeyBytes(key);
+    buffer.push_back(key);
+    count++;
+    if (memUsed >= memLimit)
+      spill();
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  size_t runCount() const {
+    return runPaths.size();
+  }
+
+  void sort() {
+    if (runPaths.empty()) {
+      sortKeys(buffer);
+      return;
+    }
+
+    if (!buffer.empty())
+      spill();
+
+    runs = std::vector<Run>(runPaths.size());
+    for (size_t i = 0; i < runPaths.size(); i++) {
+      runs[i].in.open(runPaths[i], std::ios::binary);
+      if (readSortKey(runs[i].in, runs[i].head))
+        heap.push(i);
+    }
+  }
+
+  iterator begin() {
+    return iterator(this);
+  }
+
+  iterator end() {
+    return iterator();
+  }
+};
+
+#endif
@@ -0,0 +1,663 @@
+#ifndef HASHFILE_H
+#define HASHFILE_H
+
+#include "lz.h"
+#include "record.h"
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// hash.bin: página 0 é o cabeçalho; o bucket b ocupa a página 1 + b e
+// registros excedentes vão para páginas de overflow encadeadas no fim do
+// arquivo. O número de buckets é escolhido a partir dos ids e dos tamanhos
+// dos registros carregados.
+//
+// Cada página é um slotted page: depois do BucketHeader vem a tabela de
+// slots {id, offset} em ordem de id e em seguida os registros em formato de
+// tamanho variável (packRecord), com offsets relativos ao início deles. Com
+// compressão só a área de registros é comprimida (lzCompress) e a página
+// guarda tantos registros quanto couberem depois de comprimidos; a tabela
+// de slots continua legível direto do disco.
+struct HashHeader {
+  char magic[4];
+  int32_t version;
+  int32_t bucketCount;
+  int32_t flags;
+  int32_t pageCount;
+  int32_t overflowPages;
+  int64_t recordCount;
+};
+
+struct BucketHeader {
+  int32_t overflow;
+  int32_t lastId;
+  uint16_t count;
+  uint16_t flags;
+  uint32_t rawSize;     // bytes dos registros descomprimidos
+  uint32_t storedSize;  // bytes dos registros na página
+};
+
+struct HashSlot {
+  int32_t id;
+  uint32_t offset;
+};
+
+#define HASH_FILE_VERSION 2
+#define HASH_COMPRESSED 1
+#define HASH_PAGE_BYTES (BLOCK_SIZE - sizeof(BucketHeader))
+#define PACKED_RECORD_FIXED 26
+#define OVERFLOW_COPY_PAGES 256
+// Bytes por registro do HashFileBuilder fora do buffer de Records: id e
+// tamanho, sempre em memória, e na escrita a permutação da ordenação e os
+// limites de bucket.
+#define HASH_RECORD_OVERHEAD 12
+
+inline int32_t hashBucket(int id, int32_t bucketCount) {
+  return (uint32_t) id % (uint32_t) bucketCount;
+}
+
+inline size_t packedRecordSize(const Record& rec) {
+  return PACKED_RECORD_FIXED + strnlen(rec.title, sizeof(rec.title)) + strnlen(rec.authors, sizeof(rec.authors)) +
+         strnlen(rec.snippet, sizeof(rec.snippet));
+}
+
+// Campos numéricos, os três tamanhos em 16 bits e os textos sem os zeros
+// de preenchimento dos arrays do Record. Devolve o número de bytes escritos.
+inline size_t packRecord(const Record& rec, char* out) {
+  uint16_t lengths[3] = {(uint16_t) strnlen(rec.title, sizeof(rec.title)),
+                         (uint16_t) strnlen(rec.authors, sizeof(rec.authors)),
+                         (uint16_t) strnlen(rec.snippet, sizeof(rec.snippet))};
+  int64_t dateTime = rec.dateTime;
+  char* p = out;
+  auto put = [&](const void* data, size_t size) {
+    memcpy(p, data, size);
+    p += size;
+  };
+  put(&rec.id, 4);
+  put(&rec.year, 4);
+  put(&rec.cites, 4);
+  put(&dateTime, 8);
+  put(lengths, sizeof(lengths));
+  put(rec.title, lengths[0]);
+  put(rec.authors, lengths[1]);
+  put(rec.snippet, lengths[2]);
+  return p - out;
+}
+
+inline bool unpackRecord(const char* p, size_t size, Record& rec) {
+  if (size < PACKED_RECORD_FIXED)
+    return false;
+
+  uint16_t lengths[3];
+  int64_t dateTime;
+  memcpy(lengths, p + 20, sizeof(lengths));
+  if (lengths[0] > sizeof(rec.title) || lengths[1] > sizeof(rec.authors) || lengths[2] > sizeof(rec.snippet) ||
+      PACKED_RECORD_FIXED + (size_t) lengths[0] + lengths[1] + lengths[2] > size)
+    return false;
+
+  memcpy(&rec.id, p, 4);
+  memcpy(&rec.year, p + 4, 4);
+  memcpy(&rec.cites, p + 8, 4);
+  memcpy(&dateTime, p + 12, 8);
+  rec.dateTime = dateTime;
+
+  // Os arrays do Record são lidos sempre com strnlen, então basta o '\0'
+  // depois do texto; zerar o resto custava mais que a própria cópia.
+  auto copyText = [&](char* dest, size_t size, uint16_t length) {
+    memcpy(dest, p, length);
+    if (length < size)
+      dest[length] = '\0';
+    p += length;
+  };
+  p += PACKED_RECORD_FIXED;
+  copyText(rec.title, sizeof(rec.title), lengths[0]);
+  copyText(rec.authors, sizeof(rec.authors), lengths[1]);
+  copyText(rec.snippet, sizeof(rec.snippet), lengths[2]);
+  return true;
+}
+
+// Menor número de buckets (a partir de um por página de dados) que deixa no
+// máximo ~5% dos buckets com overflow. sizes tem os bytes de cada registro
+// já com o slot; pageBytes é quanto cabe numa página (mais que
+// HASH_PAGE_BYTES com compressão).
+inline int32_t chooseBucketCount(const std::deque<int>& ids, const std::deque<uint16_t>& sizes, size_t pageBytes) {
+  int64_t total = 0;
+  for (uint16_t size : sizes)
+    total += size;
+  int32_t base = std::max<int64_t>(1, (total + pageBytes - 1) / pageBytes);
+  int32_t buckets = base;
+
+  while (buckets < 4 * base) {
+    std::vector<uint32_t> load(buckets, 0);
+    int32_t overflowed = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+      uint32_t& bytes = load[hashBucket(ids[i], buckets)];
+      if (bytes <= pageBytes && bytes + sizes[i] > pageBytes)
+        overflowed++;
+      bytes += sizes[i];
+    }
+
+    if (overflowed <= buckets / 20)
+      break;
+    buckets += std::max(1, buckets / 8);
+  }
+  return buckets;
+}
+
+// Monta em page uma página com os registros [first, first + count); devolve
+// false se eles não couberem. Com compress a página só fica comprimida se
+// isso a reduzir.
+inline bool buildPage(const std::vector<int>& ids, const std::vector<std::string>& packed, size_t first,
+                      size_t count, bool compress, char* page) {
+  size_t slotBytes = count * sizeof(HashSlot);
+  size_t rawSize = 0;
+  for (size_t i = first; i < first + count; i++)
+    rawSize += packed[i].size();
+  if (slotBytes > HASH_PAGE_BYTES || (!compress && slotBytes + rawSize > HASH_PAGE_BYTES))
+    return false;
+
+  thread_local std::vector<char> raw;
+  raw.resize(rawSize);
+  memset(page, 0, BLOCK_SIZE);
+  char* slots = page + sizeof(BucketHeader);
+  uint32_t offset = 0;
+  for (size_t i = 0; i < count; i++) {
+    HashSlot slot = {ids[first + i], offset};
+    memcpy(slots + i * sizeof(HashSlot), &slot, sizeof(HashSlot));
+    memcpy(&raw[offset], packed[first + i].data(), packed[first + i].size());
+    offset += packed[first + i].size();
+  }
+
+  BucketHeader header = {-1, count ? ids[first + count - 1] : INT_MIN, (uint16_t) count, 0, (uint32_t) rawSize,
+                         (uint32_t) rawSize};
+  char* records = slots + slotBytes;
+  size_t capacity = std::min(rawSize, HASH_PAGE_BYTES - slotBytes);
+
+  size_t stored = compress ? lzCompress(raw.data(), rawSize, records, capacity) : 0;
+  if (stored > 0 && stored < rawSize) {
+    header.flags = HASH_COMPRESSED;
+    header.storedSize = stored;
+  } else if (slotBytes + rawSize <= HASH_PAGE_BYTES) {
+    memcpy(records, raw.data(), rawSize);
+  } else {
+    return false;
+  }
+  memcpy(page, &header, sizeof(BucketHeader));
+  return true;
+}
+
+// Distribui os registros de um bucket (em ordem de id) por quantas páginas
+// forem necessárias, acrescentadas a pages com overflow = -1. Cada página
+// leva o maior prefixo restante que couber, achado por busca binária.
+inline int packBucket(const std::vector<int>& ids, const std::vector<std::string>& packed, bool compress,
+                      std::vector<char>& pages) {
+  int added = 0;
+  size_t first = 0;
+  do {
+    pages.resize(pages.size() + BLOCK_SIZE);
+    char* page = &pages[pages.size() - BLOCK_SIZE];
+    size_t remaining = ids.size() - first;
+
+    size_t count = remaining;
+    if (!buildPage(ids, packed, first, count, compress, page)) {
+      size_t lo = 1, hi = remaining;
+      while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (buildPage(ids, packed, first, mid, compress, page))
+          lo = mid;
+        else
+          hi = mid;
+      }
+      count = lo;
+      buildPage(ids, packed, first, count, compress, page);
+    }
+
+    first += count;
+    added++;
+  } while (first < ids.size());
+  return added;
+}
+
+// Razão de compressão esperada das páginas, medida numa amostra dos
+// primeiros registros comprimida em trechos do tamanho de algumas páginas.
+// Usada só para estimar quantos buckets criar.
+inline double estimateCompression(const std::string& sample) {
+  const size_t window = 3 * HASH_PAGE_BYTES;
+  std::vector<char> out(window);
+  size_t raw = 0, compressed = 0;
+  for (size_t pos = 0; pos + window <= sample.size(); pos += window) {
+    size_t size = lzCompress(sample.data() + pos, window, out.data(), window);
+    raw += window;
+    compressed += size ? size : window;
+  }
+  return compressed ? std::max(1.0, 0.9 * raw / compressed) : 1.0;
+}
+
+// Páginas de overflow guardadas num arquivo temporário (já removido do
+// diretório) enquanto as primárias são gravadas, e copiadas para o fim do
+// hash.bin quando a posição delas é conhecida.
+class OverflowSpool {
+private:
+  int fd;
+  int32_t count;
+
+public:
+  OverflowSpool() : fd(-1), count(0) {}
+  OverflowSpool(const OverflowSpool&) = delete;
+  OverflowSpool& operator=(const OverflowSpool&) = delete;
+
+  ~OverflowSpool() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  bool open(const std::string& path) {
+    if (fd >= 0)
+      ::close(fd);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    count = 0;
+    if (fd < 0)
+      return false;
+    unlink(path.c_str());
+    return true;
+  }
+
+  int32_t size() const {
+    return count;
+  }
+
+  bool add(const char* pages, int32_t n) {
+    size_t bytes = (size_t) n * BLOCK_SIZE;
+    bool ok = pwrite(fd, pages, bytes, (off_t) count * BLOCK_SIZE) == (ssize_t) bytes;
+    count += n;
+    return ok;
+  }
+
+  // Relê as páginas em lotes, soma shift aos ponteiros de overflow (os -1
+  // do fim das cadeias ficam) e passa cada lote a write(dados, bytes,
+  // primeira página), que devolve false em erro.
+  template <typename F>
+  bool copyTo(int32_t shift, F write) const {
+    std::vector<char> batch((size_t) OVERFLOW_COPY_PAGES * BLOCK_SIZE);
+    for (int32_t first = 0; first < count; first += OVERFLOW_COPY_PAGES) {
+      int32_t n = std::min(OVERFLOW_COPY_PAGES, count - first);
+      size_t bytes = (size_t) n * BLOCK_SIZE;
+      if (pread(fd, batch.data(), bytes, (off_t) first * BLOCK_SIZE) != (ssize_t) bytes)
+        return false;
+      for (int32_t k = 0; k < n; k++) {
+        int32_t next;
+        memcpy(&next, &batch[(size_t) k * BLOCK_SIZE], sizeof(int32_t));
+        if (next >= 0)
+          next += shift;
+        memcpy(&batch[(size_t) k * BLOCK_SIZE], &next, sizeof(int32_t));
+      }
+      if (!write(batch.data(), bytes, first))
+        return false;
+    }
+    return true;
+  }
+};
+
+// Grava o hash.bin recebendo os registros já agrupados por bucket (ordem
+// não decrescente de hashBucket, ids crescentes dentro do bucket). Páginas
+// primárias são escritas em sequência; páginas de overflow vão para um
+// OverflowSpool em path + ".overflow" até close().
+class HashFileWriter {
+private:
+  std::ofstream out;
+  HashHeader header;
+  int32_t currentBucket;
+  std::vector<int> ids;
+  std::vector<std::string> packed;
+  std::vector<char> pages;
+  OverflowSpool overflow;
+  bool ok;
+
+  void flushBucket() {
+    pages.clear();
+    int count = packBucket(ids, packed, header.flags & HASH_COMPRESSED, pages);
+    for (int k = 0; k + 1 < count; k++) {
+      int32_t next = 1 + header.bucketCount + header.overflowPages++;
+      memcpy(&pages[(size_t) k * BLOCK_SIZE], &next, sizeof(int32_t));
+    }
+
+    out.write(pages.data(), BLOCK_SIZE);
+    if (count > 1)
+      ok &= overflow.add(&pages[BLOCK_SIZE], count - 1);
+    ids.clear();
+    packed.clear();
+    currentBucket++;
+  }
+
+public:
+  HashFileWriter() : currentBucket(0), ok(false) {}
+
+  bool open(const std::string& path, int32_t bucketCount, bool compress) {
+    out.open(path, std::ios::binary);
+    if (!out || !overflow.open(path + ".overflow"))
+      return false;
+
+    header = {};
+    memcpy(header.magic, "HSH+", 4);
+    header.version = HASH_FILE_VERSION;
+    header.bucketCount = bucketCount;
+    header.flags = compress ? HASH_COMPRESSED : 0;
+
+    out.write(std::string(BLOCK_SIZE, '\0').data(), BLOCK_SIZE);
+    currentBucket = 0;
+    ok = true;
+    return true;
+  }
+
+  void add(const Record& record) {
+    int32_t bucket = hashBucket(record.id, header.bucketCount);
+    while (currentBucket < bucket)
+      flushBucket();
+
+    std::string bytes(packedRecordSize(record), '\0');
+    packRecord(record, &bytes[0]);
+    ids.push_back(record.id);
+    packed.push_back(std::move(bytes));
+    header.recordCount++;
+  }
+
+  int close() {
+    while (currentBucket < header.bucketCount)
+      flushBucket();
+
+    // Os ponteiros das cadeias já são absolutos.
+    ok &= overflow.copyTo(0, [&](const char* data, size_t bytes, int32_t first) {
+      return (bool) out.write(data, bytes);
+    });
+    header.pageCount = 1 + header.bucketCount + header.overflowPages;
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(HashHeader));
+    out.close();
+    return out && ok ? header.pageCount : -1;
+  }
+};
+
+// Recebe os registros em qualquer ordem com memória limitada: o buffer de
+// Records mais HASH_RECORD_OVERHEAD bytes por registro recebido ficam
+// abaixo de memLimit; acima disso os registros vão para um arquivo
+// temporário e write() gera runs ordenadas por (bucket, id) e as intercala.
+// Os ids e os tamanhos ficam sempre em memória (em deques, sem as cópias de
+// um vector que cresce), pois o número de buckets depende de todos eles.
+class HashFileBuilder {
+private:
+  struct Run {
+    std::ifstream in;
+    Record head;
+  };
+
+  std::string tmpPrefix;
+  size_t memLimit;
+  bool compress;
+  std::vector<Record> buffer;
+  std::deque<int> ids;
+  std::deque<uint16_t> sizes;
+  std::string sample;
+  std::ofstream spool;
+  std::vector<std::string> tmpPaths;
+
+  void spillBuffer() {
+    if (!spool.is_open()) {
+      tmpPaths.push_back(tmpPrefix + ".spool");
+      spool.open(tmpPaths.back(), std::ios::binary);
+    }
+    spool.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Record));
+    buffer.clear();
+    buffer.shrink_to_fit();
+  }
+
+  // Registros que cabem no buffer com o que já está fora dele.
+  size_t bufferRecords() const {
+    size_t overhead = std::min(memLimit, ids.size() * HASH_RECORD_OVERHEAD);
+    return std::max<size_t>(1, (memLimit - overhead) / sizeof(Record));
+  }
+
+  // Ordena por (bucket, id), empates na ordem de chegada, sem copiar o
+  // buffer: ordena os índices e aplica a permutação no lugar, ciclo a ciclo.
+  void sortBuffer(int32_t bucketCount) {
+    std::vector<uint32_t> order(buffer.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      int32_t bucketA = hashBucket(buffer[a].id, bucketCount), bucketB = hashBucket(buffer[b].id, bucketCount);
+      if (bucketA != bucketB)
+        return bucketA < bucketB;
+      return buffer[a].id != buffer[b].id ? buffer[a].id < buffer[b].id : a < b;
+    });
+
+    for (size_t i = 0; i < order.size(); i++) {
+      if (order[i] == i)
+        continue;
+      Record held = buffer[i];
+      size_t j = i;
+      while (order[j] != i) {
+        size_t next = order[j];
+        buffer[j] = buffer[next];
+        order[j] = j;
+        j = next;
+      }
+      buffer[j] = held;
+      order[j] = j;
+    }
+  }
+
+  // Escrita particionada do caso em memória: cada thread empacota sua faixa
+  // de buckets e grava as páginas primárias (1 + b) com pwrite. As páginas de
+  // overflow de cada thread vão para o seu OverflowSpool com numeração local;
+  // depois que todas terminam, as faixas de overflow são copiadas em
+  // sequência para o fim do arquivo com os ponteiros das cadeias corrigidos.
+  int writePartitioned(const std::string& path, int32_t bucketCount, int threads) {
+    int64_t n = buffer.size();
+    std::vector<int64_t> start(bucketCount + 1, 0);
+    for (const Record& record : buffer)
+      start[hashBucket(record.id, bucketCount) + 1]++;
+    for (int32_t b = 0; b < bucketCount; b++)
+      start[b + 1] += start[b];
+
+    std::vector<uint32_t> order(n);
+    std::vector<int64_t> pos(start.begin(), start.end() - 1);
+    for (int64_t i = 0; i < n; i++)
+      order[pos[hashBucket(buffer[i].id, bucketCount)]++] = i;
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return -1;
+
+    struct Part {
+      OverflowSpool overflow;
+      std::vector<std::pair<int32_t, int32_t>> links;
+      bool ok = true;
+    };
+
+    auto writeRange = [&](int32_t first, int32_t last, Part& part) {
+      const int32_t batch = 256;
+      std::vector<char> primary;
+      std::vector<char> pages;
+      std::vector<int> bucketIds;
+      std::vector<std::string> packed;
+
+      for (int32_t b0 = first; b0 < last; b0 += batch) {
+        int32_t b1 = std::min(last, b0 + batch);
+        primary.clear();
+
+        for (int32_t b = b0; b < b1; b++) {
+          std::stable_sort(order.begin() + start[b], order.begin() + start[b + 1],
+                           [&](uint32_t x, uint32_t y) { return buffer[x].id < buffer[y].id; });
+
+          bucketIds.clear();
+          packed.clear();
+          for (int64_t i = start[b]; i < start[b + 1]; i++) {
+            const Record& record = buffer[order[i]];
+            std::string bytes(packedRecordSize(record), '\0');
+            packRecord(record, &bytes[0]);
+            bucketIds.push_back(record.id);
+            packed.push_back(std::move(bytes));
+          }
+
+          pages.clear();
+          int count = packBucket(bucketIds, packed, compress, pages);
+          int32_t local = part.overflow.size();
+          if (count > 1)
+            part.links.push_back({b, local});
+          for (int k = 1; k + 1 < count; k++) {
+            int32_t next = local + k;
+            memcpy(&pages[(size_t) k * BLOCK_SIZE], &next, sizeof(int32_t));
+          }
+
+          primary.insert(primary.end(), pages.begin(), pages.begin() + BLOCK_SIZE);
+          if (count > 1)
+            part.ok &= part.overflow.add(&pages[BLOCK_SIZE], count - 1);
+        }
+
+        if (pwrite(fd, primary.data(), primary.size(), (off_t) (1 + b0) * BLOCK_SIZE) != (ssize_t) primary.size())
+          part.ok = false;
+      }
+    };
+
+    threads = std::max(1, std::min<int>(threads, bucketCount));
+    std::vector<Part> parts(threads);
+    for (int t = 0; t < threads; t++) {
+      if (!parts[t].overflow.open(tmpPrefix + ".overflow." + std::to_string(t))) {
+        ::close(fd);
+        return -1;
+      }
+    }
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+      workers.emplace_back(writeRange, (int64_t) bucketCount * t / threads, (int64_t) bucketCount * (t + 1) / threads,
+                           std::ref(parts[t]));
+    writeRange(0, bucketCount / threads, parts[0]);
+    for (auto& worker : workers)
+      worker.join();
+
+    HashHeader header = {};
+    memcpy(header.magic, "HSH+", 4);
+    header.version = HASH_FILE_VERSION;
+    header.bucketCount = bucketCount;
+    header.flags = compress ? HASH_COMPRESSED : 0;
+    header.recordCount = n;
+
+    bool ok = true;
+    for (Part& part : parts) {
+      int32_t base = 1 + bucketCount + header.overflowPages;
+      for (const auto& link : part.links) {
+        int32_t next = base + link.second;
+        if (pwrite(fd, &next, sizeof(int32_t), (off_t) (1 + link.first) * BLOCK_SIZE) != sizeof(int32_t))
+          ok = false;
+      }
+
+      ok &= part.overflow.copyTo(base, [&](const char* data, size_t bytes, int32_t first) {
+        return pwrite(fd, data, bytes, (off_t) (base + first) * BLOCK_SIZE) == (ssize_t) bytes;
+      });
+      header.overflowPages += part.overflow.size();
+      ok = ok && part.ok;
+    }
+    header.pageCount = 1 + bucketCount + header.overflowPages;
+
+    std::vector<char> page(BLOCK_SIZE, '\0');
+    memcpy(page.data(), &header, sizeof(HashHeader));
+    if (pwrite(fd, page.data(), BLOCK_SIZE, 0) != BLOCK_SIZE)
+      ok = false;
+
+    ::close(fd);
+    buffer.clear();
+    return ok ? header.pageCount : -1;
+  }
+
+public:
+  HashFileBuilder(const std::string& tmpPrefix, size_t memLimit, bool compress = false)
+      : tmpPrefix(tmpPrefix), memLimit(std::max(memLimit, sizeof(Record))), compress(compress) {}
+
+  ~HashFileBuilder() {
+    for (const auto& path : tmpPaths)
+      std::remove(path.c_str());
+  }
+
+  void add(const Record& record) {
+    size_t size = packedRecordSize(record);
+    if (compress && sample.size() < 64 * HASH_PAGE_BYTES) {
+      size_t old = sample.size();
+      sample.resize(old + size);
+      packRecord(record, &sample[old]);
+    }
+
+    // O buffer é reservado de uma vez para não ter as cópias de um vector
+    // que dobra; só as páginas já preenchidas ocupam memória.
+    ids.push_back(record.id);
+    sizes.push_back(sizeof(HashSlot) + size);
+    if (buffer.capacity() == 0 && memLimit != SIZE_MAX)
+      buffer.reserve(bufferRecords());
+    buffer.push_back(record);
+    if (buffer.size() * sizeof(Record) + ids.size() * HASH_RECORD_OVERHEAD >= memLimit)
+      spillBuffer();
+  }
+
+  size_t size() const {
+    return ids.size();
+  }
+
+  int write(const std::string& path, int threads = 1) {
+    size_t pageBytes = HASH_PAGE_BYTES * (compress ? estimateCompression(sample) : 1.0);
+    int32_t bucketCount = chooseBucketCount(ids, sizes, pageBytes);
+
+    if (!spool.is_open())
+      return writePartitioned(path, bucketCount, threads);
+
+    HashFileWriter out;
+    if (!out.open(path, bucketCount, compress))
+      return -1;
+
+    spillBuffer();
+    spool.close();
+
+    size_t perRun = bufferRecords();
+    std::ifstream in(tmpPaths[0], std::ios::binary);
+    std::vector<std::string> runPaths;
+    while (in) {
+      buffer.resize(perRun);
+      in.read(reinterpret_cast<char*>(buffer.data()), perRun * sizeof(Record));
+      buffer.resize(in.gcount() / sizeof(Record));
+      if (buffer.empty())
+        break;
+
+      sortBuffer(bucketCount);
+      runPaths.push_back(tmpPrefix + "." + std::to_string(runPaths.size()) + ".run");
+      tmpPaths.push_back(runPaths.back());
+      std::ofstream run(runPaths.back(), std::ios::binary);
+      run.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Record));
+    }
+    buffer.clear();
+    buffer.shrink_to_fit();
+
+    std::vector<Run> runs(runPaths.size());
+    auto greater = [&](int a, int b) {
+      int32_t bucketA = hashBucket(runs[a].head.id, bucketCount), bucketB = hashBucket(runs[b].head.id, bucketCount);
+      if (bucketA != bucketB)
+        return bucketA > bucketB;
+      return runs[a].head.id != runs[b].head.id ? runs[a].head.id > runs[b].head.id : a > b;
+    };
+    std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+
+    for (size_t i = 0; i < runs.size(); i++) {
+      runs[i].in.open(runPaths[i], std::ios::binary);
+      if (runs[i].in.read(reinterpret_cast<char*>(&runs[i].head), sizeof(Record)))
+        heap.push(i);
+    }
+
+    while (!heap.empty()) {
+      int i = heap.top();
+      heap.pop();
+      out.add(runs[i].head);
+      if (runs[i].in.read(reinterpret_cast<char*>(&runs[i].head), sizeof(Record)))
+        heap.push(i);
+    }
+
+    return out.close();
+  }
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef IOSTATS_H
+#define IOSTATS_H
+
+#include "record.h"
+#include <bits/stdc++.h>
+
+// Fases de uma consulta, cronometradas separadamente.
+enum IoPhase { PHASE_OPEN, PHASE_INDEX, PHASE_FETCH, PHASE_PRINT, PHASE_COUNT };
+
+// Valores dos contadores de E/S num momento, do processo ou de uma thread.
+struct IoCounters {
+  int64_t blocks = 0;
+  int64_t bytes = 0;
+  int64_t syscalls = 0;
+  int64_t cacheHits = 0;
+  int64_t cacheMisses = 0;
+  int64_t phaseNanos[PHASE_COUNT] = {};
+
+  int64_t phaseMicros(IoPhase phase) const {
+    return phaseNanos[phase] / 1000;
+  }
+};
+
+// Contadores de E/S do processo, alimentados por todas as leituras de
+// arquivo (PageReader, mmap do hash.bin e do text.bin) e pelos buffer pools
+// dos índices: blocos distintos de BLOCK_SIZE tocados (por descritor),
+// bytes, chamadas de sistema de leitura, acertos e faltas de cache e o tempo
+// de cada fase. Pode ser usado por várias threads: cada uma anota num
+// conjunto próprio, com um mutex que só disputa com quem lê ou zera os
+// contadores, e os conjuntos são unidos em total(). thread() e resetThread()
+// dão os contadores só da thread atual, como o bd1d faz por requisição.
+// Há uma só instância, ioStats().
+class IoStats {
+private:
+  struct Shard {
+    std::mutex lock;
+    std::unordered_set<uint64_t> blocks;
+    IoCounters counters;
+
+    void clear() {
+      blocks.clear();
+      counters = IoCounters();
+    }
+
+    void addTo(IoCounters& total) const {
+      total.bytes += counters.bytes;
+      total.syscalls += counters.syscalls;
+      total.cacheHits += counters.cacheHits;
+      total.cacheMisses += counters.cacheMisses;
+      for (int p = 0; p < PHASE_COUNT; p++)
+        total.phaseNanos[p] += counters.phaseNanos[p];
+    }
+  };
+
+  // Conjunto da thread atual, registrado no primeiro uso; ao fim da thread
+  // seus contadores passam para retired.
+  struct ShardHandle {
+    IoStats* owner = nullptr;
+    Shard shard;
+
+    ~ShardHandle() {
+      if (owner)
+        owner->retire(shard);
+    }
+  };
+
+  mutable std::mutex lock;
+  std::vector<Shard*> shards;
+  Shard retired;
+
+  IoStats() {}
+
+  Shard& localShard() {
+    thread_local ShardHandle handle;
+    if (!handle.owner) {
+      std::lock_guard<std::mutex> guard(lock);
+      handle.owner = this;
+      shards.push_back(&handle.shard);
+    }
+    return handle.shard;
+  }
+
+  void retire(Shard& shard) {
+    std::lock_guard<std::mutex> guard(lock);
+    shards.erase(std::find(shards.begin(), shards.end(), &shard));
+    retired.blocks.insert(shard.blocks.begin(), shard.blocks.end());
+    shard.addTo(retired.counters);
+  }
+
+  template <typename F>
+  void update(F apply) {
+    Shard& shard = localShard();
+    std::lock_guard<std::mutex> guard(shard.lock);
+    apply(shard);
+  }
+
+  friend IoStats& ioStats();
+
+public:
+  IoStats(const IoStats&) = delete;
+  IoStats& operator=(const IoStats&) = delete;
+
+  void reset() {
+    std::lock_guard<std::mutex> guard(lock);
+    retired.clear();
+    for (Shard* shard : shards) {
+      std::lock_guard<std::mutex> shardGuard(shard->lock);
+      shard->clear();
+    }
+  }
+
+  void resetThread() {
+    update([](Shard& shard) { shard.clear(); });
+  }
+
+  // length bytes de fd a partir de offset chegaram à memória (por read ou
+  // acessando um mapeamento).
+  void addRead(int fd, uint64_t offset, uint64_t length) {
+    if (length == 0)
+      return;
+    update([&](Shard& shard) {
+      shard.counters.bytes += length;
+      for (uint64_t b = offset / BLOCK_SIZE; b <= (offset + length - 1) / BLOCK_SIZE; b++)
+        shard.blocks.insert((uint64_t) fd << 40 | b);
+    });
+  }
+
+  void addSyscalls(int64_t count) {
+    update([&](Shard& shard) { shard.counters.syscalls += count; });
+  }
+
+  void addCacheLookup(bool hit) {
+    update([&](Shard& shard) { (hit ? shard.counters.cacheHits : shard.counters.cacheMisses)++; });
+  }
+
+  void addPhase(IoPhase phase, int64_t nanos) {
+    update([&](Shard& shard) { shard.counters.phaseNanos[phase] += nanos; });
+  }
+
+  // Contadores de todas as threads. Com uma só thread não há blocos a unir.
+  IoCounters total() const {
+    std::lock_guard<std::mutex> guard(lock);
+    IoCounters total;
+    retired.addTo(total);
+    bool single = shards.size() == 1 && retired.blocks.empty();
+    std::unordered_set<uint64_t> blocks = single ? std::unordered_set<uint64_t>() : retired.blocks;
+    for (Shard* shard : shards) {
+      std::lock_guard<std::mutex> shardGuard(shard->lock);
+      shard->addTo(total);
+      if (single)
+        total.blocks = shard->blocks.size();
+      else
+        blocks.insert(shard->blocks.begin(), shard->blocks.end());
+    }
+    if (!single)
+      total.blocks = blocks.size();
+    return total;
+  }
+
+  // Contadores só da thread atual.
+  IoCounters thread() {
+    IoCounters counters;
+    update([&](Shard& shard) {
+      counters = shard.counters;
+      counters.blocks = shard.blocks.size();
+    });
+    return counters;
+  }
+};
+
+inline IoStats& ioStats() {
+  static IoStats stats;
+  return stats;
+}
+
+// Soma ao ioStats() o tempo entre a criação e a destruição (ou stop()).
+class PhaseTimer {
+private:
+  IoPhase phase;
+  std::chrono::steady_clock::time_point start;
+  bool running;
+
+public:
+  PhaseTimer(IoPhase phase) : phase(phase), start(std::chrono::steady_clock::now()), running(true) {}
+
+  ~PhaseTimer() {
+    stop();
+  }
+
+  void stop() {
+    if (!running)
+      return;
+    running = false;
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    ioStats().addPhase(phase, nanos.count());
+  }
+};
+
+// Linha de resumo das ferramentas de consulta. Por padrão é a linha de
+// sempre, " [t ms] N blocos lidos"; com BD1_STATS=json vira um objeto JSON
+// numa linha e com qualquer outro valor de BD1_STATS ganha uma linha com o
+// detalhe de E/S e das fases. stats vem de ioStats().total() na execução
+// local e da resposta do bd1d no modo cliente.
+inline void printIoSummary(std::ostream& out, const char* tool, int64_t micros, const IoCounters& stats,
+                           bool showMillis = true) {
+  const char* mode = getenv("BD1_STATS");
+  static const char* phaseNames[PHASE_COUNT] = {"open", "index", "fetch", "print"};
+
+  if (mode && strcmp(mode, "json") == 0) {
+    out << "{\"tool\":\"" << tool << "\",\"us\":" << micros << ",\"blocks\":" << stats.blocks
+        << ",\"bytes\":" << stats.bytes << ",\"syscalls\":" << stats.syscalls << ",\"cache_hits\":" << stats.cacheHits
+        << ",\"cache_misses\":" << stats.cacheMisses << ",\"phases_us\":{";
+    for (int p = 0; p < PHASE_COUNT; p++)
+      out << (p ? "," : "") << "\"" << phaseNames[p] << "\":" << stats.phaseMicros((IoPhase) p);
+    out << "}}" << std::endl;
+    return;
+  }
+
+  if (showMillis)
+    out << " [" << micros / 1000 << " ms] ";
+  else
+    out << " [" << micros << " µs] ";
+  out << stats.blocks << (stats.blocks == 1 ? " bloco lido" : " blocos lidos") << std::endl;
+
+  if (mode) {
+    out << " E/S: " << stats.bytes << " bytes, " << stats.syscalls << " leituras, cache " << stats.cacheHits
+        << " acertos/" << stats.cacheMisses << " faltas; abertura " << stats.phaseMicros(PHASE_OPEN)
+        << " µs, índice " << stats.phaseMicros(PHASE_INDEX) << " µs, registros " << stats.phaseMicros(PHASE_FETCH)
+        << " µs, impressão " << stats.phaseMicros(PHASE_PRINT) << " µs" << std::endl;
+  }
+}
+
+inline void printIoSummary(std::ostream& out, const char* tool, int64_t micros, bool showMillis = true) {
+  printIoSummary(out, tool, micros, ioStats().total(), showMillis);
+}
+
+#endif
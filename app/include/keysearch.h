@@ -0,0 +1,64 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include <bits/stdc++.h>
+#include <immintrin.h>
+
+// upper_bound sobre as chaves int32 ordenadas de um nó: devolve quantas
+// chaves são <= key, que é também o índice do filho a seguir.
+typedef size_t (*KeySearchFn)(const int32_t* keys, size_t n, int32_t key);
+
+#define KEY_SEARCH_TAIL 32
+
+inline size_t keySearchStd(const int32_t* keys, size_t n, int32_t key) {
+  return std::upper_bound(keys, keys + n, key) - keys;
+}
+
+// Busca binária sem desvios (o compilador gera cmov) até sobrarem no máximo
+// KEY_SEARCH_TAIL chaves. Os dois candidatos do próximo passo são
+// pré-carregados, o que devolve ao nó frio o paralelismo de memória que a
+// versão com desvios ganha por especulação.
+inline void keySearchNarrow(const int32_t*& base, size_t& len, int32_t key) {
+  while (len > KEY_SEARCH_TAIL) {
+    size_t half = len / 2;
+    __builtin_prefetch(base + half / 2);
+    __builtin_prefetch(base + half + half / 2);
+    base += (base[half - 1] <= key) * half;
+    len -= half;
+  }
+}
+
+inline size_t keySearchScalar(const int32_t* keys, size_t n, int32_t key) {
+  const int32_t* base = keys;
+  size_t len = n;
+  keySearchNarrow(base, len, key);
+
+  size_t count = 0;
+  for (size_t i = 0; i < len; i++)
+    count += base[i] <= key;
+  return (base - keys) + count;
+}
+
+// O resto é contado 8 chaves por vez com compare + movemask.
+__attribute__((target("avx2,popcnt"))) inline size_t keySearchAVX2(const int32_t* keys, size_t n, int32_t key) {
+  const int32_t* base = keys;
+  size_t len = n;
+  keySearchNarrow(base, len, key);
+
+  const __m256i target = _mm256_set1_epi32(key);
+  size_t count = 0, i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i greater = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + i)), target);
+    count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+  }
+  for (; i < len; i++)
+    count += base[i] <= key;
+  return (base - keys) + count;
+}
+
+inline KeySearchFn keySearchDefault() {
+  static KeySearchFn fn = __builtin_cpu_supports("avx2") ? keySearchAVX2 : keySearchScalar;
+  return fn;
+}
+
+#endif
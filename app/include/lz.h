@@ -0,0 +1,143 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <bits/stdc++.h>
+
+// Compressor LZ77 de bloco no formato do LZ4: cada sequência é um token
+// (4 bits de tamanho de literais, 4 bits de tamanho de match - 4), os
+// literais, o offset do match em 16 bits e extensões de tamanho em bytes 255.
+// A última sequência só tem literais. Pensado para páginas de poucos KB: a
+// tabela de hash tem 4096 entradas e cabe na pilha.
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+
+inline uint32_t lzRead32(const char* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Devolve o tamanho comprimido, ou 0 se não couber em capacity bytes.
+inline size_t lzCompress(const char* src, size_t n, char* dst, size_t capacity) {
+  int32_t table[1 << LZ_HASH_BITS];
+  std::fill(table, table + (1 << LZ_HASH_BITS), -1);
+
+  size_t out = 0;
+  auto putLength = [&](size_t length) {
+    for (; length >= 255; length -= 255) {
+      if (out >= capacity)
+        return false;
+      dst[out++] = (char) 255;
+    }
+    if (out >= capacity)
+      return false;
+    dst[out++] = (char) length;
+    return true;
+  };
+  auto putSequence = [&](size_t anchor, size_t literals, size_t offset, size_t match) {
+    if (out >= capacity)
+      return false;
+    size_t extra = match ? match - LZ_MIN_MATCH : 0;
+    dst[out++] = (char) (std::min<size_t>(literals, 15) << 4 | std::min<size_t>(extra, 15));
+    if (literals >= 15 && !putLength(literals - 15))
+      return false;
+    if (literals > capacity - out)
+      return false;
+    memcpy(dst + out, src + anchor, literals);
+    out += literals;
+    if (!match)
+      return true;
+    if (capacity - out < 2)
+      return false;
+    dst[out++] = (char) (offset & 0xff);
+    dst[out++] = (char) (offset >> 8);
+    return extra < 15 || putLength(extra - 15);
+  };
+
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + LZ_MIN_MATCH <= n) {
+    uint32_t seq = lzRead32(src + i);
+    uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+    int32_t candidate = table[h];
+    table[h] = i;
+
+    if (candidate < 0 || i - candidate > 0xffff || lzRead32(src + candidate) != seq) {
+      i++;
+      continue;
+    }
+
+    size_t match = LZ_MIN_MATCH;
+    while (i + match < n && src[candidate + match] == src[i + match])
+      match++;
+    if (!putSequence(anchor, i - anchor, i - candidate, match))
+      return 0;
+    i += match;
+    anchor = i;
+  }
+
+  if (!putSequence(anchor, n - anchor, 0, 0))
+    return 0;
+  return out;
+}
+
+// Descomprime os rawSize bytes originais em dst, parando assim que os
+// primeiros limit bytes estiverem prontos. Devolve false se a entrada estiver
+// corrompida ou não produzir esse tamanho.
+inline bool lzDecompress(const char* src, size_t n, char* dst, size_t rawSize, size_t limit = SIZE_MAX) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* end = in + n;
+  size_t out = 0;
+  size_t target = std::min(limit, rawSize);
+
+  auto getLength = [&](size_t& length) {
+    unsigned char b;
+    do {
+      if (in == end)
+        return false;
+      b = *in++;
+      length += b;
+    } while (b == 255);
+    return true;
+  };
+
+  while (in < end && out < target) {
+    unsigned char token = *in++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !getLength(literals))
+      return false;
+    if (literals > (size_t) (end - in) || literals > rawSize - out)
+      return false;
+    memcpy(dst + out, in, literals);
+    in += literals;
+    out += literals;
+
+    if (in == end)
+      break;
+    if (end - in < 2)
+      return false;
+    size_t offset = in[0] | in[1] << 8;
+    in += 2;
+    size_t match = token & 15;
+    if (match == 15 && !getLength(match))
+      return false;
+    match += LZ_MIN_MATCH;
+    if (offset == 0 || offset > out || match > rawSize - out)
+      return false;
+
+    // Matches podem sobrepor a saída (offset < match): com offset >= 8 cada
+    // cópia de 8 bytes lê só o que já foi escrito; perto do fim ou com
+    // offset menor, byte a byte.
+    if (offset >= 8 && rawSize - out >= match + 8) {
+      for (size_t k = 0; k < match; k += 8)
+        memcpy(dst + out + k, dst + out + k - offset, 8);
+      out += match;
+    } else {
+      for (size_t k = 0; k < match; k++, out++)
+        dst[out] = dst[out - offset];
+    }
+  }
+  return out >= target;
+}
+
+#endif
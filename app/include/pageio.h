@@ -0,0 +1,362 @@
+#ifndef PAGEIO_H
+#define PAGEIO_H
+
+#include "iostats.h"
+#include <bits/stdc++.h>
+
+// <linux/io_uring.h> inclui <linux/fs.h>, que define um BLOCK_SIZE de 1 KiB;
+// o do record.h, se já definido, é preservado.
+#pragma push_macro("BLOCK_SIZE")
+#undef BLOCK_SIZE
+#include <linux/io_uring.h>
+#undef BLOCK_SIZE
+#pragma pop_macro("BLOCK_SIZE")
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define PAGEIO_QUEUE_DEPTH 32
+#define PAGEIO_ALIGNMENT 4096
+
+// Uma leitura de length bytes de fd a partir de offset. done acumula os
+// bytes já lidos; leituras curtas são completadas pelo próprio leitor.
+struct PageRead {
+  int fd;
+  off_t offset;
+  char* buffer;
+  size_t length;
+  size_t done;
+};
+
+// Backend de leitura de páginas usado pelos índices e pelo hash.bin.
+// readAll executa todas as leituras do lote, mantendo até depth() delas em
+// andamento, e devolve false se alguma falhar ou terminar antes do fim do
+// arquivo. Cada instância é de uma thread só.
+class PageReader {
+public:
+  virtual ~PageReader() {}
+  virtual const char* name() const = 0;
+  virtual size_t depth() const = 0;
+  virtual bool readAll(PageRead* reads, size_t count) = 0;
+
+  bool read(int fd, char* buffer, size_t length, off_t offset) {
+    PageRead request = {fd, offset, buffer, length, 0};
+    return readAll(&request, 1);
+  }
+};
+
+// Uma chamada pread por leitura, em sequência.
+class PreadReader : public PageReader {
+public:
+  const char* name() const override {
+    return "pread";
+  }
+
+  size_t depth() const override {
+    return 1;
+  }
+
+  bool readAll(PageRead* reads, size_t count) override {
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+      PageRead& r = reads[i];
+      while (r.done < r.length) {
+        ssize_t n = pread(r.fd, r.buffer + r.done, r.length - r.done, r.offset + r.done);
+        ioStats().addSyscalls(1);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n <= 0) {
+          ok = false;
+          break;
+        }
+        ioStats().addRead(r.fd, r.offset + r.done, n);
+        r.done += n;
+      }
+    }
+    return ok;
+  }
+};
+
+// io_uring direto pelas syscalls (sem liburing): as leituras do lote entram
+// na fila de submissão até depth em andamento, e cada io_uring_enter envia
+// as novas e espera ao menos uma conclusão. Leituras curtas são reenviadas
+// a partir de onde pararam.
+class UringReader : public PageReader {
+private:
+  int ring;
+  bool broken;
+  PreadReader fallback;
+  unsigned entries;
+  void* sqMap;
+  size_t sqMapSize;
+  void* cqMap;
+  size_t cqMapSize;
+  io_uring_sqe* sqes;
+  size_t sqesSize;
+
+  unsigned* sqHead;
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  io_uring_cqe* cqes;
+
+  void unmap() {
+    if (sqes)
+      munmap(sqes, sqesSize);
+    if (cqMap && cqMap != sqMap)
+      munmap(cqMap, cqMapSize);
+    if (sqMap)
+      munmap(sqMap, sqMapSize);
+    if (ring >= 0)
+      ::close(ring);
+    ring = -1;
+    sqMap = cqMap = nullptr;
+    sqes = nullptr;
+  }
+
+  void push(const PageRead& r, uint64_t tag) {
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r.fd;
+    sqe->off = r.offset + r.done;
+    sqe->addr = (uint64_t) (uintptr_t) (r.buffer + r.done);
+    sqe->len = r.length - r.done;
+    sqe->user_data = tag;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // IORING_OP_READ só existe a partir do 5.6; antes disso o anel é criado,
+  // mas toda leitura termina com -EINVAL. O probe, do mesmo kernel, diz
+  // quais operações são aceitas.
+  bool supportsRead() const {
+    std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), '\0');
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, 256) < 0)
+      return false;
+    return probe->last_op >= IORING_OP_READ && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+  }
+
+  // Consome as conclusões já postas no CQ.
+  void reap(PageRead* reads, size_t& inFlight, std::vector<size_t>& retry, bool& ok) {
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const io_uring_cqe& cqe = cqes[head & *cqMask];
+      PageRead& r = reads[cqe.user_data];
+      inFlight--;
+      if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+        retry.push_back(cqe.user_data);
+      } else if (cqe.res <= 0) {
+        ok = false;
+      } else {
+        ioStats().addRead(r.fd, r.offset + r.done, cqe.res);
+        r.done += cqe.res;
+        if (r.done < r.length)
+          retry.push_back(cqe.user_data);
+      }
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  // Depois de um io_uring_enter com erro: tira da fila o que o kernel não
+  // consumiu e espera as leituras já enviadas, que ainda escrevem nos
+  // buffers do chamador. Se nem a espera funcionar, o anel não é mais usado
+  // (e as próximas leituras vão por pread), para que conclusões antigas não
+  // sejam tomadas por leituras de outro lote.
+  void abandon(PageRead* reads, size_t& inFlight, std::vector<size_t>& retry, bool& ok) {
+    unsigned unsent = *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    __atomic_store_n(sqTail, *sqTail - unsent, __ATOMIC_RELEASE);
+    inFlight -= unsent;
+
+    while (inFlight > 0) {
+      int n = syscall(__NR_io_uring_enter, ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      ioStats().addSyscalls(1);
+      if (n < 0 && errno != EINTR) {
+        broken = true;
+        return;
+      }
+      reap(reads, inFlight, retry, ok);
+    }
+  }
+
+public:
+  UringReader() : ring(-1), broken(false), entries(0), sqMap(nullptr), cqMap(nullptr), sqes(nullptr) {}
+
+  UringReader(const UringReader&) = delete;
+  UringReader& operator=(const UringReader&) = delete;
+
+  ~UringReader() {
+    unmap();
+  }
+
+  // Cria o anel com depth entradas. Falha onde io_uring não existe ou é
+  // bloqueado (kernels antigos, seccomp de containers).
+  bool setup(unsigned depth) {
+    io_uring_params params = {};
+    ring = syscall(__NR_io_uring_setup, depth, &params);
+    if (ring < 0)
+      return false;
+    if (!supportsRead()) {
+      unmap();
+      return false;
+    }
+    entries = params.sq_entries;
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+      sqMap = nullptr;
+      unmap();
+      return false;
+    }
+    cqMap = single ? sqMap
+                   : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring,
+                          IORING_OFF_CQ_RING);
+    if (cqMap == MAP_FAILED) {
+      cqMap = nullptr;
+      unmap();
+      return false;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    if (sqeMap == MAP_FAILED) {
+      unmap();
+      return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+    char* sq = static_cast<char*>(sqMap);
+    char* cq = static_cast<char*>(cqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  const char* name() const override {
+    return "io_uring";
+  }
+
+  size_t depth() const override {
+    return entries;
+  }
+
+  bool readAll(PageRead* reads, size_t count) override {
+    if (broken)
+      return fallback.readAll(reads, count);
+
+    bool ok = true;
+    size_t next = 0;
+    size_t inFlight = 0;
+    std::vector<size_t> retry;
+
+    while (next < count || inFlight > 0 || !retry.empty()) {
+      while (inFlight < entries && (!retry.empty() || next < count)) {
+        size_t i;
+        if (!retry.empty()) {
+          i = retry.back();
+          retry.pop_back();
+        } else {
+          i = next++;
+        }
+        push(reads[i], i);
+        inFlight++;
+      }
+
+      // Entradas ainda não consumidas pelo kernel (um enter interrompido
+      // pode ter deixado algumas para trás).
+      unsigned queued = *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+      int n = syscall(__NR_io_uring_enter, ring, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      ioStats().addSyscalls(1);
+      if (n < 0 && errno != EINTR) {
+        abandon(reads, inFlight, retry, ok);
+        return false;
+      }
+      reap(reads, inFlight, retry, ok);
+    }
+    return ok;
+  }
+};
+
+// io_uring com depth entradas, ou pread se ele não estiver disponível (ou
+// não tiver IORING_OP_READ) ou se BD1_IO=pread.
+inline std::unique_ptr<PageReader> makePageReader(size_t depth = PAGEIO_QUEUE_DEPTH) {
+  const char* backend = getenv("BD1_IO");
+  if (!backend || strcmp(backend, "pread") != 0) {
+    std::unique_ptr<UringReader> uring(new UringReader());
+    if (uring->setup(depth))
+      return uring;
+  }
+  return std::unique_ptr<PageReader>(new PreadReader());
+}
+
+inline std::unique_ptr<PageReader>& threadPageReaderSlot() {
+  thread_local std::unique_ptr<PageReader> reader;
+  return reader;
+}
+
+// Leitor padrão da thread, criado no primeiro uso.
+inline PageReader& threadPageReader() {
+  std::unique_ptr<PageReader>& reader = threadPageReaderSlot();
+  if (!reader)
+    reader = makePageReader();
+  return *reader;
+}
+
+// Troca o leitor da thread (por exemplo, por outra profundidade de fila).
+inline void setThreadPageReader(std::unique_ptr<PageReader> reader) {
+  threadPageReaderSlot() = std::move(reader);
+}
+
+// Buffer alinhado a PAGEIO_ALIGNMENT, exigido pelas leituras com O_DIRECT.
+class AlignedBuffer {
+private:
+  char* bytes;
+  size_t capacity;
+
+public:
+  AlignedBuffer() : bytes(nullptr), capacity(0) {}
+
+  AlignedBuffer(const AlignedBuffer&) = delete;
+  AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+  ~AlignedBuffer() {
+    free(bytes);
+  }
+
+  // Garante ao menos size bytes; o conteúdo anterior não é preservado.
+  char* reserve(size_t size) {
+    if (size > capacity) {
+      free(bytes);
+      void* p = nullptr;
+      if (posix_memalign(&p, PAGEIO_ALIGNMENT, size) != 0)
+        throw std::bad_alloc();
+      bytes = static_cast<char*>(p);
+      capacity = size;
+    }
+    return bytes;
+  }
+
+  char* data() const {
+    return bytes;
+  }
+};
+
+#endif
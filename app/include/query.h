@@ -0,0 +1,372 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "b+tree.h"
+#include "iostats.h"
+#include "record.h"
+#include "recordstore.h"
+#include "secondary.h"
+#include "textindex.h"
+#include <bits/stdc++.h>
+
+#define SEEK1_LIMIT 100
+#define SEEK2_LIMIT 100
+#define SEEK3_LIMIT 100
+
+// Consultas de findrec/seek1/seek2/seek3, compartilhadas pelas ferramentas e pelo
+// bd1d. Escrevem a saída em out e devolvem o código de saída da ferramenta.
+
+// O tempo de cada fase (índice, registros, impressão) vai para ioStats().
+
+int findrecQuery(const RecordStore& store, int id, std::ostream& out) {
+  Record rec;
+  PhaseTimer fetch(PHASE_FETCH);
+  bool found = store.find(id, rec);
+  fetch.stop();
+
+  PhaseTimer print(PHASE_PRINT);
+  if (!found) {
+    out << "registro não encontrado" << std::endl;
+    return 1;
+  }
+
+  rec.print(out);
+  return 0;
+}
+
+int seek1Query(const BPlusTree<int>& idx1, const RecordStore& store, int id, std::ostream& out) {
+  PhaseTimer index(PHASE_INDEX);
+  bool found = idx1.search(id);
+  index.stop();
+
+  if (!found) {
+    out << "registro não encontrado" << std::endl;
+    return 1;
+  }
+
+  return findrecQuery(store, id, out);
+}
+
+// Registros com from <= id <= to, em ordem de id, no máximo limit. Os ids
+// vêm da varredura das folhas do idx1 e os registros são buscados em lotes
+// de MULTIGET_BATCH com multiGet, em ordem de página do hash.bin.
+int seek1RangeQuery(const BPlusTree<int>& idx1, const RecordStore& store, int from, int to, std::ostream& out,
+                    size_t limit = SEEK1_LIMIT) {
+  PhaseTimer open(PHASE_INDEX);
+  auto cursor = to == INT_MAX ? idx1.scan(from) : idx1.scan(from, to + 1);
+  open.stop();
+
+  size_t printed = 0;
+  std::vector<int> ids;
+  std::vector<Record> records;
+  std::vector<bool> found;
+  while (printed < limit) {
+    ids.clear();
+    {
+      PhaseTimer walk(PHASE_INDEX);
+      for (; cursor.valid() && ids.size() < MULTIGET_BATCH && printed + ids.size() < limit; cursor.next())
+        ids.push_back(cursor.key());
+    }
+    if (ids.empty())
+      break;
+
+    PhaseTimer fetch(PHASE_FETCH);
+    store.multiGet(ids.data(), ids.size(), records, found);
+    fetch.stop();
+
+    PhaseTimer print(PHASE_PRINT);
+    for (size_t i = 0; i < ids.size(); i++) {
+      if (!found[i])
+        continue;
+      out << std::endl;
+      records[i].print(out);
+    }
+    printed += ids.size();
+  }
+
+  if (printed == 0) {
+    out << "nenhum registro encontrado" << std::endl;
+    return 1;
+  }
+  if (cursor.valid())
+    out << std::endl << "mais resultados: --from " << cursor.key() << std::endl;
+  return 0;
+}
+
+// Lista os títulos que começam com title a partir do offset-ésimo, no máximo
+// limit registros. Sem nenhum título com esse prefixo, procura title como
+// substring (sem distinguir maiúsculas) em títulos e snippets pelo text.bin;
+// sem ele, cai na busca por substring nas primeiras folhas do idx2.
+int seek2Query(const BPlusTree<std::pair<std::string, int>>& idx2, const TextIndex* text,
+               const RecordStore& store, const std::string& title, std::ostream& out, size_t offset = 0,
+               size_t limit = SEEK2_LIMIT) {
+  PhaseTimer index(PHASE_INDEX);
+  std::vector<int> ids;
+  bool more = false;
+  bool prefixFound = false;
+  {
+    auto cursor = idx2.scanPrefix(title);
+    prefixFound = cursor.valid();
+    cursor.advance(offset);
+    for (; cursor.valid() && ids.size() < limit; cursor.next())
+      ids.push_back(cursor.view().second);
+    more = cursor.valid();
+  }
+
+  // Os registros já conferidos na busca pelo text.bin vão direto para a
+  // impressão; os demais caminhos só dão ids.
+  std::vector<Record> records;
+  if (!prefixFound && text && text->isOpen()) {
+    size_t skipped = 0;
+    Record rec;
+    for (auto candidate = text->candidates(title); candidate.valid(); candidate.next()) {
+      if (!store.find(candidate.id(), rec) || !recordMatches(rec, title))
+        continue;
+      if (skipped < offset) {
+        skipped++;
+      } else if (records.size() == limit) {
+        more = true;
+        break;
+      } else {
+        records.push_back(rec);
+      }
+    }
+  } else if (!prefixFound) {
+    auto results = idx2.searchBySubstring(title);
+    for (size_t i = offset; i < results.size() && ids.size() < limit; i++)
+      ids.push_back(results[i].second);
+    more = results.size() > offset + ids.size();
+  }
+
+  index.stop();
+
+  if (ids.empty() && records.empty()) {
+    out << "nenhum registro encontrado" << std::endl;
+    return 1;
+  }
+
+  PhaseTimer fetch(PHASE_FETCH);
+  Record rec;
+  for (int id : ids)
+    if (store.find(id, rec))
+      records.push_back(rec);
+  fetch.stop();
+
+  PhaseTimer print(PHASE_PRINT);
+  for (const Record& record : records) {
+    out << std::endl;
+    record.print(out);
+  }
+  print.stop();
+
+  size_t shown = ids.empty() ? records.size() : ids.size();
+  if (more)
+    out << std::endl << "mais resultados: --offset " << offset + shown << std::endl;
+  return 0;
+}
+
+// Filtros e forma da resposta do seek3. Ano e citações são combináveis;
+// com top > 0 a resposta são os top mais citados que passam nos filtros.
+struct Seek3Request {
+  int yearFrom = INT_MIN;
+  int yearTo = INT_MAX;
+  int citesAbove = INT_MIN;
+  size_t top = 0;
+  bool count = false;
+  bool idsOnly = false;
+  size_t limit = SEEK3_LIMIT;
+
+  bool byYear() const {
+    return yearFrom != INT_MIN || yearTo != INT_MAX;
+  }
+
+  bool byCites() const {
+    return citesAbove != INT_MIN;
+  }
+
+  // Contagens e listas de ids saem só dos índices, sem o hash.bin.
+  bool needsRecords() const {
+    return !count && !idsOnly;
+  }
+};
+
+// Ids do intervalo de anos de request, ordenados por id.
+std::vector<int> yearIds(const SecondaryIndex& years, const Seek3Request& request) {
+  std::vector<int> ids;
+  for (auto cursor = scanYears(years, request.yearFrom, request.yearTo); cursor.valid(); cursor.next())
+    ids.push_back(cursor.view().second);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Consulta de intervalo e top-N sobre os índices secundários. years só é
+// usado com filtro de ano e cites só com filtro de citações ou top; store
+// só quando request pede os registros, que são buscados com multiGet.
+int seek3Query(const SecondaryIndex* years, const SecondaryIndex* cites, const RecordStore* store,
+               const Seek3Request& request, std::ostream& out) {
+  PhaseTimer index(PHASE_INDEX);
+  size_t wanted = request.top ? std::min(request.top, request.limit) : request.limit;
+  std::vector<int> ids;
+  size_t total = 0;
+  bool more = false;
+
+  if (request.top) {
+    // Varre dos mais citados para os menos até achar top artigos do
+    // intervalo de anos.
+    std::vector<int> inYears;
+    if (request.byYear())
+      inYears = yearIds(*years, request);
+    for (auto cursor = scanCitesAbove(*cites, request.citesAbove); cursor.valid() && total < request.top;
+         cursor.next()) {
+      int id = cursor.view().second;
+      if (request.byYear() && !std::binary_search(inYears.begin(), inYears.end(), id))
+        continue;
+      if (ids.size() < wanted)
+        ids.push_back(id);
+      total++;
+    }
+    more = total > ids.size();
+  } else if (request.byYear() && request.byCites()) {
+    // Interseção das duas listas de ids, na ordem de (ano, id).
+    std::vector<int> cited;
+    for (auto cursor = scanCitesAbove(*cites, request.citesAbove); cursor.valid(); cursor.next())
+      cited.push_back(cursor.view().second);
+    std::sort(cited.begin(), cited.end());
+
+    for (auto cursor = scanYears(*years, request.yearFrom, request.yearTo); cursor.valid(); cursor.next()) {
+      int id = cursor.view().second;
+      if (!std::binary_search(cited.begin(), cited.end(), id))
+        continue;
+      if (ids.size() < wanted)
+        ids.push_back(id);
+      total++;
+    }
+    more = total > ids.size();
+  } else {
+    auto cursor = request.byYear() ? scanYears(*years, request.yearFrom, request.yearTo)
+                                   : scanCitesAbove(*cites, request.citesAbove);
+    for (; cursor.valid() && (request.count || ids.size() < wanted); cursor.next(), total++)
+      if (!request.count)
+        ids.push_back(cursor.view().second);
+    more = cursor.valid();
+  }
+  index.stop();
+
+  if (request.count) {
+    out << total << (total == 1 ? " registro" : " registros") << std::endl;
+    return 0;
+  }
+  if (ids.empty()) {
+    out << "nenhum registro encontrado" << std::endl;
+    return 1;
+  }
+
+  if (request.idsOnly) {
+    PhaseTimer print(PHASE_PRINT);
+    for (int id : ids)
+      out << id << std::endl;
+  } else {
+    std::vector<Record> records;
+    std::vector<bool> found;
+    for (size_t first = 0; first < ids.size(); first += MULTIGET_BATCH) {
+      size_t count = std::min<size_t>(MULTIGET_BATCH, ids.size() - first);
+      PhaseTimer fetch(PHASE_FETCH);
+      store->multiGet(ids.data() + first, count, records, found);
+      fetch.stop();
+
+      PhaseTimer print(PHASE_PRINT);
+      for (size_t i = 0; i < count; i++) {
+        if (!found[i])
+          continue;
+        out << std::endl;
+        records[i].print(out);
+      }
+    }
+  }
+
+  if (more)
+    out << std::endl << "mais resultados: aumente --limit ou use --count para o total" << std::endl;
+  return 0;
+}
+
+// Interpreta "--from A --to B [--limit N]" do seek1 (em qualquer ordem;
+// sem --to vai até o fim do índice). Devolve false se alguma opção for
+// desconhecida ou tiver valor inválido.
+bool parseSeek1Range(const std::string& request, int& from, int& to, size_t& limit) {
+  std::istringstream in(request);
+  std::string option;
+  bool hasFrom = false;
+  while (in >> option) {
+    long long value = -1;
+    if (!(in >> value) || value < 0 || value > INT_MAX)
+      return false;
+    if (option == "--from")
+      from = value, hasFrom = true;
+    else if (option == "--to")
+      to = value;
+    else if (option == "--limit" && value > 0)
+      limit = value;
+    else
+      return false;
+  }
+  return hasFrom && from <= to;
+}
+
+// Interpreta as opções do seek3 (em qualquer ordem): "--year Y",
+// "--from-year A", "--to-year B", "--cites-above C", "--top N", "--limit N",
+// "--count" e "--ids". Devolve false se alguma opção for desconhecida ou
+// inválida, se --count e --ids vierem juntos ou se não houver filtro nem top.
+bool parseSeek3Options(const std::string& text, Seek3Request& request) {
+  std::istringstream in(text);
+  std::string option;
+  while (in >> option) {
+    if (option == "--count") {
+      request.count = true;
+      continue;
+    }
+    if (option == "--ids") {
+      request.idsOnly = true;
+      continue;
+    }
+
+    long long value = 0;
+    if (!(in >> value) || value < INT_MIN + 1LL || value > INT_MAX - 1LL)
+      return false;
+    if (option == "--year")
+      request.yearFrom = request.yearTo = value;
+    else if (option == "--from-year")
+      request.yearFrom = value;
+    else if (option == "--to-year")
+      request.yearTo = value;
+    else if (option == "--cites-above")
+      request.citesAbove = value;
+    else if ((option == "--top" || option == "--limit") && value > 0)
+      (option == "--top" ? request.top : request.limit) = value;
+    else
+      return false;
+  }
+  return !(request.count && request.idsOnly) && request.yearFrom <= request.yearTo &&
+         (request.byYear() || request.byCites() || request.top);
+}
+
+// Remove do início de request as opções "--offset N" e "--limit N" do seek2.
+// Devolve false se alguma delas tiver valor inválido (negativo, com sobra
+// após o número ou --limit 0).
+bool parseSeek2Options(std::string& request, size_t& offset, size_t& limit) {
+  while (request.compare(0, 2, "--") == 0) {
+    std::istringstream in(request);
+    std::string option;
+    long long value = -1;
+    in >> option >> value;
+    if ((option != "--offset" && option != "--limit") || !in || value < 0 || (option == "--limit" && value == 0) ||
+        !(in.eof() || isspace(in.peek())))
+      return false;
+
+    (option == "--offset" ? offset : limit) = value;
+    in >> std::ws;
+    request = in.eof() ? "" : request.substr(in.tellg());
+  }
+  return true;
+}
+
+#endif
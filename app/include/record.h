@@ -4,21 +4,159 @@
 #include <bits/stdc++.h>
 
 #define BLOCK_SIZE 4096
-#define MAP_SIZE 1021441
-#define MAX_REC_ID 162450
 #define REC_SIZE 1496
 
-time_t parseDateTime(const std::string& datetime_str) {
-  struct tm tm = {};
-  std::istringstream ss(datetime_str);
-  ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-  return mktime(&tm);
+// Datas são gravadas como segundos UTC desde 1970, sem passar por locale
+// nem fuso horário. daysFromCivil/civilFromDays seguem o algoritmo de
+// Howard Hinnant para o calendário gregoriano proléptico.
+int64_t daysFromCivil(int64_t y, int64_t m, int64_t d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, int& m, int& d) {
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = yoe + era * 400 + (m <= 2);
+}
+
+// Aceita "YYYY-MM-DD HH:MM:SS"; fora desse layout lê até seis grupos de
+// dígitos separados por qualquer outro caractere (hora opcional). Campos
+// fora do intervalo são normalizados como no mktime (ex.: 30/02 -> 01/03).
+// Sem ano, mês e dia devolve false (e deixa result como está).
+bool parseDateTime(std::string_view text, time_t& result) {
+  auto digit = [&](int i) { return (unsigned) (text[i] - '0'); };
+
+  if (text.size() == 19 && text[4] == '-' && text[7] == '-' && text[10] == ' ' && text[13] == ':' &&
+      text[16] == ':') {
+    unsigned check = 0;
+    for (int i : {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18})
+      check |= digit(i) > 9;
+
+    if (!check) {
+      int64_t y = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+      int64_t days = daysFromCivil(y, digit(5) * 10 + digit(6), digit(8) * 10 + digit(9));
+      result = days * 86400 + (digit(11) * 10 + digit(12)) * 3600 + (digit(14) * 10 + digit(15)) * 60 +
+               digit(17) * 10 + digit(18);
+      return true;
+    }
+  }
+
+  int64_t parts[6] = {0, 0, 0, 0, 0, 0};
+  int count = 0;
+  for (size_t i = 0; i < text.size() && count < 6;) {
+    if (digit(i) > 9) {
+      i++;
+      continue;
+    }
+    int64_t value = 0;
+    for (; i < text.size() && digit(i) <= 9 && value < 100000000; i++)
+      value = value * 10 + digit(i);
+    parts[count++] = value;
+  }
+
+  if (count < 3)
+    return false;
+  result = daysFromCivil(parts[0], parts[1], parts[2]) * 86400 + parts[3] * 3600 + parts[4] * 60 + parts[5];
+  return true;
+}
+
+// Como acima, com 0 quando não há data.
+time_t parseDateTime(std::string_view text) {
+  time_t result = 0;
+  parseDateTime(text, result);
+  return result;
+}
+
+int parseInt(std::string_view text) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+    negative = text[i++] == '-';
+
+  if (i == text.size() || !isdigit((unsigned char) text[i]))
+    throw std::invalid_argument("parseInt");
+
+  long value = 0;
+  for (; i < text.size() && isdigit((unsigned char) text[i]); i++) {
+    value = value * 10 + (text[i] - '0');
+    if (value > (long) INT_MAX + 1)
+      throw std::out_of_range("parseInt");
+  }
+
+  value = negative ? -value : value;
+  if (value > INT_MAX)
+    throw std::out_of_range("parseInt");
+  return value;
+}
+
+// Tamanho de memória com sufixo opcional B, K/KB, M/MB ou G/GB ("256M").
+size_t parseSize(const std::string& text) {
+  size_t pos;
+  double value = std::stod(text, &pos);
+  std::string unit = text.substr(pos);
+  if (value <= 0)
+    throw std::invalid_argument(text);
+
+  if (unit == "" || unit == "B")
+    return value;
+  if (unit == "K" || unit == "KB")
+    return value * (1L << 10);
+  if (unit == "M" || unit == "MB")
+    return value * (1L << 20);
+  if (unit == "G" || unit == "GB")
+    return value * (1L << 30);
+  throw std::invalid_argument(text);
+}
+
+// Escreve "YYYY-MM-DD HH:MM:SS" (UTC) em out, que deve ter 20 bytes.
+void formatDateTime(time_t timestamp, char* out) {
+  int64_t days = timestamp / 86400, secs = timestamp % 86400;
+  if (secs < 0) {
+    secs += 86400;
+    days--;
+  }
+
+  int64_t y;
+  int m, d;
+  civilFromDays(days, y, m, d);
+  if (y < 0 || y > 9999) {
+    snprintf(out, 20, "%04" PRId64 "-%02d-%02d", y, m, d);
+    return;
+  }
+
+  auto put2 = [](char* p, int v) {
+    p[0] = '0' + v / 10;
+    p[1] = '0' + v % 10;
+  };
+  put2(out, y / 100);
+  put2(out + 2, y % 100);
+  out[4] = '-';
+  put2(out + 5, m);
+  out[7] = '-';
+  put2(out + 8, d);
+  out[10] = ' ';
+  put2(out + 11, secs / 3600);
+  out[13] = ':';
+  put2(out + 14, secs / 60 % 60);
+  out[16] = ':';
+  put2(out + 17, secs % 60);
+  out[19] = '\0';
 }
 
 std::string formatDateTime(time_t timestamp) {
-  char buffer[32];
-  struct tm* tm_info = localtime(&timestamp);
-  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", tm_info);
+  char buffer[20];
+  formatDateTime(timestamp, buffer);
   return std::string(buffer);
 }
 
@@ -38,6 +176,8 @@ struct Record {
   }
 
   Record(std::vector<std::string>& fields) {
+    memset(static_cast<void*>(this), 0, sizeof(Record));
+
     id = std::stoi(fields[0]);
     year = std::stoi(fields[2]);
     cites = std::stoi(fields[4]);
@@ -49,14 +189,39 @@ struct Record {
     dateTime = parseDateTime(fields[5]);
   }
 
-  void print() {
-    std::cout << "         ID: " << id << std::endl;
-    std::cout << "     Título: " << title << std::endl;
-    std::cout << "        Ano: " << year << std::endl;
-    std::cout << "    Autores: " << authors << std::endl;
-    std::cout << "   Citações: " << cites << std::endl;
-    std::cout << "Atualização: " << formatDateTime(dateTime) << std::endl;
-    std::cout << "    Snippet: " << snippet << std::endl;
+  Record(const std::string_view* fields) {
+    memset(static_cast<void*>(this), 0, sizeof(Record));
+
+    id = parseInt(fields[0]);
+    year = parseInt(fields[2]);
+    cites = parseInt(fields[4]);
+
+    copyField(title, sizeof(title), fields[1]);
+    copyField(authors, sizeof(authors), fields[3]);
+    copyField(snippet, sizeof(snippet), fields[6]);
+
+    dateTime = parseDateTime(fields[5]);
+  }
+
+  static void copyField(char* dest, size_t size, std::string_view field) {
+    size_t n = std::min(size, field.size());
+    const void* nul = memchr(field.data(), '\0', n);
+    if (nul)
+      n = static_cast<const char*>(nul) - field.data();
+    memcpy(dest, field.data(), n);
+  }
+
+  void print(std::ostream& out = std::cout) const {
+    char updated[20];
+    formatDateTime(dateTime, updated);
+
+    out << "         ID: " << id << std::endl;
+    out << "     Título: " << std::string_view(title, strnlen(title, sizeof(title))) << std::endl;
+    out << "        Ano: " << year << std::endl;
+    out << "    Autores: " << std::string_view(authors, strnlen(authors, sizeof(authors))) << std::endl;
+    out << "   Citações: " << cites << std::endl;
+    out << "Atualização: " << updated << std::endl;
+    out << "    Snippet: " << std::string_view(snippet, strnlen(snippet, sizeof(snippet))) << std::endl;
   }
 };
 
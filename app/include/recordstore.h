@@ -0,0 +1,279 @@
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+
+#include "hashfile.h"
+#include "pageio.h"
+#include "record.h"
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MULTIGET_GAP 4
+#define MULTIGET_BATCH 16384
+#define MULTIGET_RUN_PAGES 32
+
+struct BatchStats {
+  int64_t pages;
+  int64_t reads;
+  int64_t bytes;
+};
+
+// Acesso somente leitura ao hash.bin via mmap: find() decodifica o registro
+// direto do mapeamento, sem syscall por consulta.
+class RecordStore {
+public:
+  enum Advice { NORMAL, RANDOM, SEQUENTIAL };
+
+private:
+  int fd;
+  int directFd;
+  const char* data;
+  size_t size;
+  HashHeader header;
+
+  const BucketHeader* pageAt(int32_t page) const {
+    if ((size_t) (page + 1) * BLOCK_SIZE > size)
+      return nullptr;
+    return reinterpret_cast<const BucketHeader*>(data + (size_t) page * BLOCK_SIZE);
+  }
+
+  enum PageLookup { FOUND, ABSENT, NEXT };
+
+  // Procura id numa página de bucket. NEXT: se existir, o id está numa
+  // página seguinte da cadeia.
+  static PageLookup lookupInPage(const BucketHeader* bucket, int id, Record& out) {
+    if (bucket->lastId < id)
+      return NEXT;
+
+    const char* slots = reinterpret_cast<const char*>(bucket + 1);
+    size_t slotBytes = bucket->count * sizeof(HashSlot);
+    if (slotBytes + bucket->storedSize > HASH_PAGE_BYTES)
+      return ABSENT;
+
+    auto slotAt = [&](size_t i) {
+      HashSlot slot;
+      memcpy(&slot, slots + i * sizeof(HashSlot), sizeof(HashSlot));
+      return slot;
+    };
+    size_t lo = 0, hi = bucket->count;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (slotAt(mid).id < id)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == bucket->count || slotAt(lo).id != id)
+      return ABSENT;
+
+    uint32_t begin = slotAt(lo).offset;
+    uint32_t end = lo + 1 < bucket->count ? slotAt(lo + 1).offset : bucket->rawSize;
+    if (begin > end || end > bucket->rawSize)
+      return ABSENT;
+
+    const char* records = slots + slotBytes;
+    if (bucket->flags & HASH_COMPRESSED) {
+      thread_local std::vector<char> raw;
+      raw.resize(bucket->rawSize);
+      if (!lzDecompress(records, bucket->storedSize, raw.data(), bucket->rawSize, end))
+        return ABSENT;
+      records = raw.data();
+    }
+    // Pede todas as linhas do registro de uma vez antes das cópias, que
+    // de outro modo esperariam cada falta de cache em sequência.
+    for (uint32_t offset = begin; offset < end; offset += 64)
+      __builtin_prefetch(records + offset);
+    return unpackRecord(records + begin, end - begin, out) ? FOUND : ABSENT;
+  }
+
+  // Lê pages (ordenadas, sem repetição) para buffer e devolve onde cada
+  // uma ficou. Páginas separadas por até MULTIGET_GAP páginas vão na mesma
+  // leitura, junto com o intervalo, até MULTIGET_RUN_PAGES por leitura; as
+  // leituras são entregues de uma vez ao reader.
+  std::vector<size_t> readPages(const std::vector<int32_t>& pages, AlignedBuffer& buffer, PageReader& reader,
+                                BatchStats& stats) const {
+    std::vector<size_t> where(pages.size());
+    std::vector<PageRead> reads;
+    size_t bytes = 0;
+    for (size_t first = 0, last; first < pages.size(); first = last + 1) {
+      last = first;
+      while (last + 1 < pages.size() && pages[last + 1] - pages[last] <= MULTIGET_GAP + 1 &&
+             pages[last + 1] - pages[first] < MULTIGET_RUN_PAGES)
+        last++;
+
+      for (size_t k = first; k <= last; k++)
+        where[k] = bytes + (size_t) (pages[k] - pages[first]) * BLOCK_SIZE;
+      size_t length = (size_t) (pages[last] - pages[first] + 1) * BLOCK_SIZE;
+      reads.push_back({directFd >= 0 ? directFd : fd, (off_t) pages[first] * BLOCK_SIZE, nullptr, length, 0});
+      bytes += length;
+    }
+
+    char* base = buffer.reserve(bytes);
+    for (size_t i = 0, offset = 0; i < reads.size(); offset += reads[i].length, i++)
+      reads[i].buffer = base + offset;
+    // Uma leitura que falhe deixa suas páginas com conteúdo indefinido:
+    // zera o que faltou, e a página vazia não contém nenhum id.
+    if (!reader.readAll(reads.data(), reads.size()))
+      for (auto& r : reads)
+        memset(r.buffer + r.done, 0, r.length - r.done);
+
+    stats.reads += reads.size();
+    stats.pages += bytes / BLOCK_SIZE;
+    stats.bytes += bytes;
+    return where;
+  }
+
+public:
+  RecordStore() : fd(-1), directFd(-1), data(nullptr), size(0) {}
+
+  RecordStore(const RecordStore&) = delete;
+  RecordStore& operator=(const RecordStore&) = delete;
+
+  ~RecordStore() {
+    close();
+  }
+
+  // Com direct, multiGet lê por um segundo descritor aberto com O_DIRECT, sem
+  // passar pelo cache de páginas do kernel; falha se o sistema de arquivos
+  // não suportar O_DIRECT. find() continua pelo mmap.
+  bool open(const std::string& path, Advice advice = RANDOM, bool populate = false, bool direct = false) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+      close();
+      return false;
+    }
+
+    size = st.st_size;
+    if (size < BLOCK_SIZE) {
+      close();
+      return false;
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED | (populate ? MAP_POPULATE : 0), fd, 0);
+    if (addr == MAP_FAILED) {
+      data = nullptr;
+      close();
+      return false;
+    }
+    data = static_cast<const char*>(addr);
+
+    int hint = advice == RANDOM ? MADV_RANDOM : advice == SEQUENTIAL ? MADV_SEQUENTIAL : MADV_NORMAL;
+    madvise(const_cast<char*>(data), size, hint);
+
+    memcpy(&header, data, sizeof(HashHeader));
+    if (memcmp(header.magic, "HSH+", 4) != 0 || header.version != HASH_FILE_VERSION || header.bucketCount < 1) {
+      close();
+      return false;
+    }
+
+    if (direct) {
+      directFd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+      if (directFd < 0) {
+        close();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void close() {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+    if (fd >= 0)
+      ::close(fd);
+    if (directFd >= 0)
+      ::close(directFd);
+    fd = directFd = -1;
+    data = nullptr;
+    size = 0;
+  }
+
+  bool isOpen() const {
+    return fd >= 0;
+  }
+
+  int64_t recordCount() const {
+    return header.recordCount;
+  }
+
+  // Copia para out o registro com esse id. A tabela de slots é lida direto
+  // do mapeamento; numa página comprimida só o trecho até o fim do registro
+  // procurado é descomprimido, num buffer da thread.
+  bool find(int id, Record& out) const {
+    int32_t page = 1 + hashBucket(id, header.bucketCount);
+
+    while (page != -1) {
+      const BucketHeader* bucket = pageAt(page);
+      if (!bucket)
+        return false;
+      ioStats().addRead(fd, (uint64_t) page * BLOCK_SIZE, BLOCK_SIZE);
+
+      PageLookup result = lookupInPage(bucket, id, out);
+      if (result != NEXT)
+        return result == FOUND;
+      page = bucket->overflow;
+    }
+    return false;
+  }
+
+  // Busca em lote: out[i] recebe o registro de ids[i] e found[i] diz se ele
+  // existe, na ordem pedida. As páginas primárias dos ids são ordenadas,
+  // deduplicadas e lidas em ordem de arquivo com preadv, juntando trechos
+  // próximos; as de overflow necessárias vêm em rodadas seguintes, do mesmo
+  // modo. Não passa pelo mmap: as leituras vão pelo reader dado (por padrão
+  // o da thread), que pode manter várias em andamento.
+  BatchStats multiGet(const int* ids, size_t count, std::vector<Record>& out, std::vector<bool>& found,
+                      PageReader* reader = nullptr) const {
+    BatchStats stats = {};
+    out.resize(count);
+    found.assign(count, false);
+
+    std::vector<size_t> pending;
+    std::vector<int32_t> target(count);
+    for (size_t i = 0; i < count; i++) {
+      target[i] = 1 + hashBucket(ids[i], header.bucketCount);
+      if (pageAt(target[i]))
+        pending.push_back(i);
+    }
+
+    if (!reader)
+      reader = &threadPageReader();
+
+    std::vector<int32_t> pages;
+    AlignedBuffer buffer;
+    while (!pending.empty()) {
+      pages.clear();
+      for (size_t i : pending)
+        pages.push_back(target[i]);
+      std::sort(pages.begin(), pages.end());
+      pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+      std::vector<size_t> where = readPages(pages, buffer, *reader, stats);
+
+      size_t kept = 0;
+      for (size_t i : pending) {
+        size_t k = std::lower_bound(pages.begin(), pages.end(), target[i]) - pages.begin();
+        const BucketHeader* bucket = reinterpret_cast<const BucketHeader*>(buffer.data() + where[k]);
+        PageLookup result = lookupInPage(bucket, ids[i], out[i]);
+        if (result == FOUND) {
+          found[i] = true;
+        } else if (result == NEXT && bucket->overflow != -1 && pageAt(bucket->overflow)) {
+          target[i] = bucket->overflow;
+          pending[kept++] = i;
+        }
+      }
+      pending.resize(kept);
+    }
+    return stats;
+  }
+};
+
+#endif
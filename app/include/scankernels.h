@@ -0,0 +1,151 @@
+#ifndef SCANKERNELS_H
+#define SCANKERNELS_H
+
+#include <bits/stdc++.h>
+#include <immintrin.h>
+
+// Kernels das varreduras de colunas. A seleção de um pedaço de n linhas é
+// um mapa de bits: o bit j da palavra w é a linha 64w + j, e os bits além
+// de n ficam sempre zerados. Cada filtro faz AND do seu resultado na
+// seleção, então filtros se encadeiam sem vetores intermediários.
+typedef void (*RangeFilter32Fn)(const int32_t* values, size_t n, int32_t lo, int32_t hi, uint64_t* selection);
+typedef void (*RangeFilter64Fn)(const int64_t* values, size_t n, int64_t lo, int64_t hi, uint64_t* selection);
+
+// Seleção com as n primeiras linhas.
+inline void selectAll(size_t n, std::vector<uint64_t>& selection) {
+  selection.assign((n + 63) / 64, ~0ULL);
+  if (n % 64)
+    selection.back() = (1ULL << (n % 64)) - 1;
+}
+
+template <typename V>
+inline uint64_t rangeBitsScalar(const V* values, size_t n, V lo, V hi) {
+  uint64_t bits = 0;
+  for (size_t j = 0; j < n; j++)
+    bits |= (uint64_t) (values[j] >= lo && values[j] <= hi) << j;
+  return bits;
+}
+
+// Mantém na seleção as linhas com lo <= valor <= hi.
+inline void rangeFilter32Scalar(const int32_t* values, size_t n, int32_t lo, int32_t hi, uint64_t* selection) {
+  for (size_t i = 0; i < n; i += 64)
+    selection[i / 64] &= rangeBitsScalar(values + i, std::min<size_t>(64, n - i), lo, hi);
+}
+
+inline void rangeFilter64Scalar(const int64_t* values, size_t n, int64_t lo, int64_t hi, uint64_t* selection) {
+  for (size_t i = 0; i < n; i += 64)
+    selection[i / 64] &= rangeBitsScalar(values + i, std::min<size_t>(64, n - i), lo, hi);
+}
+
+// 8 valores por comparação: fora do intervalo é valor > hi ou lo > valor,
+// e o movemask desse resultado dá 8 bits da seleção. Palavras já zeradas
+// não são lidas.
+__attribute__((target("avx2"))) inline void rangeFilter32AVX2(const int32_t* values, size_t n, int32_t lo,
+                                                              int32_t hi, uint64_t* selection) {
+  const __m256i low = _mm256_set1_epi32(lo), high = _mm256_set1_epi32(hi);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    if (!selection[i / 64])
+      continue;
+    uint64_t bits = 0;
+    for (int k = 0; k < 8; k++) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 8 * k));
+      __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(v, high), _mm256_cmpgt_epi32(low, v));
+      bits |= (uint64_t) (~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xff) << (8 * k);
+    }
+    selection[i / 64] &= bits;
+  }
+  if (i < n)
+    selection[i / 64] &= rangeBitsScalar(values + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) inline void rangeFilter64AVX2(const int64_t* values, size_t n, int64_t lo,
+                                                              int64_t hi, uint64_t* selection) {
+  const __m256i low = _mm256_set1_epi64x(lo), high = _mm256_set1_epi64x(hi);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    if (!selection[i / 64])
+      continue;
+    uint64_t bits = 0;
+    for (int k = 0; k < 16; k++) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4 * k));
+      __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(v, high), _mm256_cmpgt_epi64(low, v));
+      bits |= (uint64_t) (~_mm256_movemask_pd(_mm256_castsi256_pd(out)) & 0xf) << (4 * k);
+    }
+    selection[i / 64] &= bits;
+  }
+  if (i < n)
+    selection[i / 64] &= rangeBitsScalar(values + i, n - i, lo, hi);
+}
+
+inline RangeFilter32Fn rangeFilter32Default() {
+  static RangeFilter32Fn fn = __builtin_cpu_supports("avx2") ? rangeFilter32AVX2 : rangeFilter32Scalar;
+  return fn;
+}
+
+inline RangeFilter64Fn rangeFilter64Default() {
+  static RangeFilter64Fn fn = __builtin_cpu_supports("avx2") ? rangeFilter64AVX2 : rangeFilter64Scalar;
+  return fn;
+}
+
+inline int64_t countSelected(const uint64_t* selection, size_t words) {
+  int64_t count = 0;
+  for (size_t w = 0; w < words; w++)
+    count += __builtin_popcountll(selection[w]);
+  return count;
+}
+
+// Chama visit(i) para cada linha selecionada, em ordem.
+template <typename F>
+inline void forEachSelected(const uint64_t* selection, size_t words, F visit) {
+  for (size_t w = 0; w < words; w++)
+    for (uint64_t bits = selection[w]; bits; bits &= bits - 1)
+      visit(w * 64 + __builtin_ctzll(bits));
+}
+
+// Contagem, soma, mínimo e máximo dos valores selecionados.
+struct IntAggregate {
+  int64_t count = 0;
+  int64_t sum = 0;
+  int64_t min = INT64_MAX;
+  int64_t max = INT64_MIN;
+
+  void merge(const IntAggregate& other) {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+};
+
+// Palavras com as 64 linhas selecionadas são somadas num laço sem desvios,
+// que o compilador vetoriza; as demais percorrem só os bits marcados.
+inline void aggregateSelected(const int32_t* values, const uint64_t* selection, size_t words, IntAggregate& out) {
+  for (size_t w = 0; w < words; w++) {
+    uint64_t bits = selection[w];
+    if (bits == ~0ULL) {
+      const int32_t* v = values + w * 64;
+      int64_t sum = 0;
+      int32_t lo = INT32_MAX, hi = INT32_MIN;
+      for (int j = 0; j < 64; j++) {
+        sum += v[j];
+        lo = std::min(lo, v[j]);
+        hi = std::max(hi, v[j]);
+      }
+      out.count += 64;
+      out.sum += sum;
+      out.min = std::min<int64_t>(out.min, lo);
+      out.max = std::max<int64_t>(out.max, hi);
+      continue;
+    }
+    for (; bits; bits &= bits - 1) {
+      int32_t v = values[w * 64 + __builtin_ctzll(bits)];
+      out.count++;
+      out.sum += v;
+      out.min = std::min<int64_t>(out.min, v);
+      out.max = std::max<int64_t>(out.max, v);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,472 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include "iostats.h"
+#include "record.h"
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// text.bin: índice invertido de trigramas sobre título e snippet. Cada
+// texto é posto em minúsculas (ASCII) e completado com dois bytes 0, e cada
+// posição gera o trigrama (t[i], t[i+1], t[i+2]) codificado em 24 bits.
+//
+// Layout: cabeçalho, listas de ids e, no fim, o diretório ordenado por
+// trigrama ({termo, contagem, offset}). Cada lista guarda os ids em ordem
+// crescente (como uint32) em blocos de TEXT_BLOCK_IDS: primeiro a tabela de
+// saltos {último id, fim do bloco} e depois os deltas em varint, o primeiro
+// de cada bloco relativo ao último id do bloco anterior. A tabela permite
+// pular blocos inteiros na interseção sem decodificá-los.
+struct TextHeader {
+  char magic[4];
+  int32_t version;
+  int32_t termCount;
+  int32_t blockIds;
+  int64_t docCount;
+  int64_t postingCount;
+  int64_t directoryOffset;
+};
+
+struct TextTerm {
+  uint32_t term;
+  uint32_t count;
+  uint64_t offset;
+};
+
+struct TextSkip {
+  uint32_t lastId;
+  uint32_t end;
+};
+
+#define TEXT_FILE_VERSION 1
+#define TEXT_BLOCK_IDS 128
+// Palavras de 64 bits do mapa de bits dos 2^24 trigramas (2 MiB por thread).
+#define TRIGRAM_SEEN_WORDS (1 << 18)
+
+inline unsigned char foldByte(char c) {
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+inline uint32_t trigramAt(std::string_view text, size_t i) {
+  auto at = [&](size_t j) -> uint32_t { return j < text.size() ? foldByte(text[j]) : 0; };
+  return at(i) << 16 | at(i + 1) << 8 | at(i + 2);
+}
+
+// Acrescenta a terms os trigramas de text ainda não marcados em seen,
+// incluindo os dois que passam do fim.
+inline void textTrigrams(std::string_view text, std::vector<uint64_t>& seen, std::vector<uint32_t>& terms) {
+  uint32_t term = 0;
+  for (size_t j = 0; j < text.size() + 2; j++) {
+    term = (term << 8 | (j < text.size() ? foldByte(text[j]) : 0)) & 0xffffff;
+    if (j >= 2 && !(seen[term >> 6] >> (term & 63) & 1)) {
+      seen[term >> 6] |= 1ULL << (term & 63);
+      terms.push_back(term);
+    }
+  }
+}
+
+// Trigramas distintos de título e snippet de um registro, sem ordem. Um
+// mapa de bits por thread com todos os 2^24 trigramas evita ordenar ~1300
+// termos por registro só para remover repetidos.
+inline std::vector<uint32_t> recordTrigrams(const Record& rec) {
+  thread_local std::vector<uint64_t> seen(TRIGRAM_SEEN_WORDS);
+  std::vector<uint32_t> terms;
+  textTrigrams(std::string_view(rec.title, strnlen(rec.title, sizeof(rec.title))), seen, terms);
+  textTrigrams(std::string_view(rec.snippet, strnlen(rec.snippet, sizeof(rec.snippet))), seen, terms);
+  for (uint32_t term : terms)
+    seen[term >> 6] = 0;
+  return terms;
+}
+
+inline bool containsFolded(std::string_view text, std::string_view folded) {
+  auto it = std::search(text.begin(), text.end(), folded.begin(), folded.end(),
+                        [](char a, char b) { return foldByte(a) == (unsigned char) b; });
+  return it != text.end();
+}
+
+// Confirma um candidato: o índice só garante que todos os trigramas da
+// consulta aparecem, não que aparecem em sequência.
+inline bool recordMatches(const Record& rec, const std::string& query) {
+  std::string folded(query.size(), '\0');
+  std::transform(query.begin(), query.end(), folded.begin(), foldByte);
+  return containsFolded(std::string_view(rec.title, strnlen(rec.title, sizeof(rec.title))), folded) ||
+         containsFolded(std::string_view(rec.snippet, strnlen(rec.snippet, sizeof(rec.snippet))), folded);
+}
+
+inline void writeVarint(std::vector<char>& out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back((char) (value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char) value);
+}
+
+inline uint32_t readVarint(const unsigned char*& p) {
+  uint32_t value = *p & 0x7f;
+  for (int shift = 7; *p++ & 0x80; shift += 7)
+    value |= (uint32_t) (*p & 0x7f) << shift;
+  return value;
+}
+
+// Recebe os pares (trigrama, id) em ordem crescente e grava o text.bin.
+// Pares repetidos são ignorados.
+class TextIndexWriter {
+private:
+  std::ofstream out;
+  TextHeader header;
+  std::vector<TextTerm> directory;
+  std::vector<uint32_t> ids;
+  uint32_t term;
+  int64_t offset;
+
+  void flushTerm() {
+    if (ids.empty())
+      return;
+
+    std::vector<TextSkip> skips;
+    std::vector<char> data;
+    uint32_t prev = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+      writeVarint(data, ids[i] - prev);
+      prev = ids[i];
+      if ((i + 1) % TEXT_BLOCK_IDS == 0 || i + 1 == ids.size())
+        skips.push_back({prev, (uint32_t) data.size()});
+    }
+
+    // Cada lista começa alinhada a 4 bytes, como a sua tabela de saltos.
+    data.resize((data.size() + 3) & ~3, '\0');
+    directory.push_back({term, (uint32_t) ids.size(), (uint64_t) offset});
+    out.write(reinterpret_cast<const char*>(skips.data()), skips.size() * sizeof(TextSkip));
+    out.write(data.data(), data.size());
+    offset += skips.size() * sizeof(TextSkip) + data.size();
+    header.postingCount += ids.size();
+    ids.clear();
+  }
+
+public:
+  TextIndexWriter() : term(0), offset(0) {}
+
+  bool open(const std::string& path, int64_t docCount) {
+    out.open(path, std::ios::binary);
+    if (!out)
+      return false;
+
+    header = {};
+    memcpy(header.magic, "TXT+", 4);
+    header.version = TEXT_FILE_VERSION;
+    header.blockIds = TEXT_BLOCK_IDS;
+    header.docCount = docCount;
+
+    out.write(std::string(BLOCK_SIZE, '\0').data(), BLOCK_SIZE);
+    offset = BLOCK_SIZE;
+    directory.clear();
+    ids.clear();
+    return true;
+  }
+
+  // Par codificado como (trigrama << 32) | id, a mesma ordem do ExternalSorter.
+  void add(uint64_t posting) {
+    uint32_t t = posting >> 32, id = (uint32_t) posting;
+    if (t != term || ids.empty()) {
+      flushTerm();
+      term = t;
+    } else if (ids.back() == id) {
+      return;
+    }
+    ids.push_back(id);
+  }
+
+  // Devolve o número de blocos do arquivo, ou -1 em erro.
+  int close() {
+    flushTerm();
+    if (offset % 8) {
+      out.write("\0\0\0\0", 4);
+      offset += 4;
+    }
+    header.termCount = directory.size();
+    header.directoryOffset = offset;
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(TextTerm));
+    offset += directory.size() * sizeof(TextTerm);
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(TextHeader));
+    out.close();
+    return out ? (offset + BLOCK_SIZE - 1) / BLOCK_SIZE : -1;
+  }
+};
+
+// Leitura do text.bin via mmap. candidates() percorre, em ordem crescente,
+// os ids cujos textos contêm todos os trigramas da consulta; quem chama
+// confirma cada um com recordMatches(). Pode ser usado por várias threads.
+class TextIndex {
+private:
+  // Percorre uma lista decodificando um bloco por vez.
+  class Postings {
+  private:
+    int fd;
+    const char* base;
+    const TextSkip* skips;
+    const unsigned char* data;
+    size_t blockCount;
+    size_t block;
+    uint32_t buffer[TEXT_BLOCK_IDS];
+    size_t length;
+    size_t pos;
+
+    void decode(size_t b) {
+      const unsigned char* p = data + (b ? skips[b - 1].end : 0);
+      const unsigned char* end = data + skips[b].end;
+      uint32_t prev = b ? skips[b - 1].lastId : 0;
+      ioStats().addRead(fd, reinterpret_cast<const char*>(p) - base, end - p);
+      length = 0;
+      while (p < end)
+        buffer[length++] = prev += readVarint(p);
+      block = b;
+      pos = 0;
+    }
+
+  public:
+    size_t count;
+
+    Postings(int fd, const char* base, const TextTerm& term)
+        : fd(fd), base(base), skips(reinterpret_cast<const TextSkip*>(base + term.offset)),
+          blockCount((term.count + TEXT_BLOCK_IDS - 1) / TEXT_BLOCK_IDS), block(0), length(0), pos(0),
+          count(term.count) {
+      data = reinterpret_cast<const unsigned char*>(skips + blockCount);
+      ioStats().addRead(fd, term.offset, blockCount * sizeof(TextSkip));
+    }
+
+    // Volta ao começo da lista.
+    void rewind() {
+      block = length = pos = 0;
+    }
+
+    // Avança até o primeiro id >= target; false se não houver. Chamadas
+    // sucessivas (até um rewind) devem ter targets crescentes.
+    bool seek(uint32_t target) {
+      if (blockCount == 0 || skips[blockCount - 1].lastId < target)
+        return false;
+      if (pos >= length || buffer[length - 1] < target) {
+        size_t b = block + (length > 0);
+        while (skips[b].lastId < target)
+          b++;
+        decode(b);
+      }
+      while (buffer[pos] < target)
+        pos++;
+      return true;
+    }
+
+    uint32_t current() const {
+      return buffer[pos];
+    }
+  };
+
+  int fd;
+  const char* data;
+  size_t size;
+  TextHeader header;
+  const TextTerm* directory;
+
+  const TextTerm* findTerm(uint32_t term) const {
+    const TextTerm* end = directory + header.termCount;
+    const TextTerm* it =
+        std::lower_bound(directory, end, term, [](const TextTerm& t, uint32_t key) { return t.term < key; });
+    if (it == end)
+      return nullptr;
+    ioStats().addRead(fd, reinterpret_cast<const char*>(it) - data, sizeof(TextTerm));
+    return it->term == term ? it : nullptr;
+  }
+
+public:
+  TextIndex() : fd(-1), data(nullptr), size(0), directory(nullptr) {}
+
+  TextIndex(const TextIndex&) = delete;
+  TextIndex& operator=(const TextIndex&) = delete;
+
+  ~TextIndex() {
+    close();
+  }
+
+  bool open(const std::string& path) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < BLOCK_SIZE) {
+      close();
+      return false;
+    }
+    size = st.st_size;
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      close();
+      return false;
+    }
+    data = static_cast<const char*>(addr);
+    madvise(const_cast<char*>(data), size, MADV_RANDOM);
+
+    memcpy(&header, data, sizeof(TextHeader));
+    if (memcmp(header.magic, "TXT+", 4) != 0 || header.version != TEXT_FILE_VERSION ||
+        header.blockIds != TEXT_BLOCK_IDS || header.termCount < 0 || header.directoryOffset < BLOCK_SIZE ||
+        header.directoryOffset % 8 != 0 ||
+        (size_t) header.directoryOffset + header.termCount * sizeof(TextTerm) > size) {
+      close();
+      return false;
+    }
+    directory = reinterpret_cast<const TextTerm*>(data + header.directoryOffset);
+    return true;
+  }
+
+  void close() {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    data = nullptr;
+    size = 0;
+    directory = nullptr;
+  }
+
+  bool isOpen() const {
+    return data != nullptr;
+  }
+
+  int64_t termCount() const {
+    return header.termCount;
+  }
+
+  int64_t postingCount() const {
+    return header.postingCount;
+  }
+
+  // Candidatos de uma consulta, produzidos sob demanda em ordem crescente de
+  // id (como int: negativos primeiro, por isso duas passadas sobre os ids
+  // sem sinal). Com três ou mais bytes é a interseção das listas dos
+  // trigramas da consulta, que saltam juntas (leapfrog) para o maior id
+  // visto; consultas curtas são a união, por um heap, das listas dos
+  // trigramas que começam com elas (o preenchimento com zeros garante que
+  // ocorrências no fim do texto também geram um desses trigramas). Só os
+  // blocos alcançados são decodificados, então parar cedo sai barato.
+  class Candidates {
+  private:
+    typedef std::pair<uint32_t, size_t> HeapEntry;
+
+    std::vector<Postings> lists;
+    bool intersect;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    int pass;
+    uint32_t currentId;
+    bool hasCurrent;
+
+    // Primeiro id >= target da passada atual.
+    bool find(uint32_t target) {
+      uint32_t last = pass == 0 ? UINT32_MAX : INT32_MAX;
+      uint32_t candidate = target;
+      if (intersect) {
+        for (size_t l = 0, agreed = 0; agreed < lists.size(); l = (l + 1) % lists.size()) {
+          if (!lists[l].seek(candidate))
+            return false;
+          if (lists[l].current() == candidate) {
+            agreed++;
+          } else {
+            candidate = lists[l].current();
+            agreed = 1;
+          }
+        }
+      } else {
+        while (!heap.empty() && heap.top().first < target) {
+          size_t l = heap.top().second;
+          heap.pop();
+          if (lists[l].seek(target))
+            heap.push({lists[l].current(), l});
+        }
+        if (heap.empty())
+          return false;
+        candidate = heap.top().first;
+      }
+      if (candidate > last)
+        return false;
+      currentId = candidate;
+      return true;
+    }
+
+    void startPass(int p) {
+      pass = p;
+      uint32_t first = p == 0 ? (uint32_t) INT32_MAX + 1 : 0;
+      for (auto& list : lists)
+        list.rewind();
+      heap = decltype(heap)();
+      for (size_t l = 0; !intersect && l < lists.size(); l++)
+        if (lists[l].seek(first))
+          heap.push({lists[l].current(), l});
+      hasCurrent = !lists.empty() && find(first);
+    }
+
+    void settle() {
+      if (!hasCurrent && pass == 0)
+        startPass(1);
+    }
+
+  public:
+    Candidates(std::vector<Postings> lists, bool intersect) : lists(std::move(lists)), intersect(intersect) {
+      // A lista mais curta guia a interseção.
+      std::sort(this->lists.begin(), this->lists.end(),
+                [](const Postings& a, const Postings& b) { return a.count < b.count; });
+      startPass(0);
+      settle();
+    }
+
+    bool valid() const {
+      return hasCurrent;
+    }
+
+    int id() const {
+      return (int) currentId;
+    }
+
+    void next() {
+      uint32_t current = currentId;
+      hasCurrent = current != (pass == 0 ? UINT32_MAX : (uint32_t) INT32_MAX) && find(current + 1);
+      settle();
+    }
+  };
+
+  Candidates candidates(const std::string& query) const {
+    std::vector<Postings> lists;
+    if (query.size() >= 3) {
+      std::vector<uint32_t> terms;
+      for (size_t i = 0; i + 3 <= query.size(); i++)
+        terms.push_back(trigramAt(query, i));
+      std::sort(terms.begin(), terms.end());
+      terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+      for (uint32_t term : terms) {
+        const TextTerm* found = findTerm(term);
+        if (!found)
+          return Candidates({}, true);
+        lists.emplace_back(fd, data, *found);
+      }
+      return Candidates(std::move(lists), true);
+    }
+
+    if (!query.empty()) {
+      uint32_t lo = trigramAt(query, 0), hi = lo | (query.size() == 1 ? 0xffff : 0xff);
+      const TextTerm* end = directory + header.termCount;
+      const TextTerm* it =
+          std::lower_bound(directory, end, lo, [](const TextTerm& t, uint32_t key) { return t.term < key; });
+      for (; it != end && it->term <= hi; it++)
+        lists.emplace_back(fd, data, *it);
+    }
+    return Candidates(std::move(lists), false);
+  }
+};
+
+#endif
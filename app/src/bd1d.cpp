@@ -0,0 +1,478 @@
+#include "b+tree.h"
+#include "bd1d.h"
+#include "iostats.h"
+#include "query.h"
+#include "record.h"
+#include "recordstore.h"
+#include "textindex.h"
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#define LATENCY_WINDOW 100000
+#define CACHE_BYTES (64L << 20)
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int) {
+  stopping = 1;
+}
+
+// Latências das últimas LATENCY_WINDOW consultas, para o comando "stats".
+// Alimentada por todas as threads de trabalho.
+struct LatencyStats {
+  mutable std::mutex lock;
+  std::vector<int64_t> window;
+  size_t next = 0;
+  int64_t count = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  void add(int64_t micros) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (window.size() < LATENCY_WINDOW)
+      window.push_back(micros);
+    else
+      window[next++ % LATENCY_WINDOW] = micros;
+    count++;
+  }
+
+  int64_t percentile(std::vector<int64_t>& sorted, double p) const {
+    if (sorted.empty())
+      return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t) (p * sorted.size()))];
+  }
+
+  void print(std::ostream& out) const {
+    std::unique_lock<std::mutex> guard(lock);
+    std::vector<int64_t> sorted = window;
+    int64_t count = this->count;
+    guard.unlock();
+    std::sort(sorted.begin(), sorted.end());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    out << count << " consultas, " << std::fixed << std::setprecision(1) << count / seconds << " consultas/s"
+        << std::endl;
+    out << "p50 " << percentile(sorted, 0.50) << " µs, p99 " << percentile(sorted, 0.99) << " µs" << std::endl;
+  }
+};
+
+class Server {
+private:
+  RecordStore store;
+  BPlusTree<int> idx1;
+  BPlusTree<std::pair<std::string, int>> idx2;
+  TextIndex text;
+  LatencyStats stats;
+
+public:
+  Server() : idx1(170), idx2(6) {}
+
+  bool open(const std::string& hashPath, const std::string& idx1Path, const std::string& idx2Path,
+            const std::string& textPath, size_t cacheBytes) {
+    if (!store.open(hashPath, RecordStore::RANDOM, getenv("BD1_WARM") != nullptr)) {
+      std::cerr << "Erro: não foi possível abrir " << hashPath << std::endl;
+      return false;
+    }
+    // O orçamento do cache é dividido entre os dois índices.
+    int64_t cachePages = std::max<int64_t>(2, cacheBytes / BLOCK_SIZE);
+    if (!idx1.loadFromFile(idx1Path, cachePages / 2)) {
+      std::cerr << "Erro: não foi possível carregar o índice primário" << std::endl;
+      return false;
+    }
+    if (!idx2.loadFromFile(idx2Path, cachePages - cachePages / 2)) {
+      std::cerr << "Erro: não foi possível carregar o índice secundário" << std::endl;
+      return false;
+    }
+
+    // Bancos gerados antes do text.bin continuam atendidos, com a busca por
+    // substring restrita às primeiras folhas do idx2.
+    if (!text.open(textPath))
+      std::cerr << "Aviso: " << textPath << " indisponível, busca por substring limitada" << std::endl;
+
+    // Aquece o cache com os níveis internos; as folhas são lidas sob demanda.
+    idx1.preload(idx1.getHeight() - 1);
+    idx2.preload(idx2.getHeight() - 1);
+    return true;
+  }
+
+  int64_t cachedPages() const {
+    return idx1.getCacheStats().residentPages + idx2.getCacheStats().residentPages;
+  }
+
+  void printCache(std::ostream& out, const char* name, const BufferPoolStats& cache, int64_t capacity) const {
+    int64_t lookups = cache.hits + cache.misses;
+    out << name << ": " << cache.residentPages << "/" << capacity << " páginas, " << cache.hits << " acertos, "
+        << cache.misses << " faltas, " << cache.evictions << " despejos";
+    if (lookups > 0)
+      out << " (" << std::fixed << std::setprecision(1) << 100.0 * cache.hits / lookups << "% acertos)";
+    out << std::endl;
+  }
+
+  int64_t recordCount() const {
+    return store.recordCount();
+  }
+
+  // Executa uma linha de requisição e devolve a resposta completa. Chamado
+  // por várias threads de trabalho ao mesmo tempo.
+  std::string handle(const std::string& request) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    size_t space = request.find(' ');
+    std::string command = request.substr(0, space);
+    std::string arg = space == std::string::npos ? "" : request.substr(space + 1);
+
+    std::ostringstream out;
+    int status = 1;
+    ioStats().resetThread();
+
+    if (command == "stats") {
+      stats.print(out);
+      printCache(out, "idx1", idx1.getCacheStats(), idx1.getCacheCapacity());
+      printCache(out, "idx2", idx2.getCacheStats(), idx2.getCacheCapacity());
+      status = 0;
+    } else if (command == "seek1" && arg.compare(0, 2, "--") == 0) {
+      int from = 0, to = INT_MAX;
+      size_t limit = SEEK1_LIMIT;
+      if (!parseSeek1Range(arg, from, to, limit))
+        out << "Erro: opções inválidas: " << arg << std::endl;
+      else
+        status = seek1RangeQuery(idx1, store, from, to, out, limit);
+    } else if (command == "findrec" || command == "seek1") {
+      int id = 0;
+      try {
+        id = std::stoi(arg);
+      } catch (const std::exception& e) {
+      }
+
+      if (id < 1)
+        out << "Erro: id inválido: " << arg << std::endl;
+      else if (command == "findrec")
+        status = findrecQuery(store, id, out);
+      else
+        status = seek1Query(idx1, store, id, out);
+    } else if (command == "seek2") {
+      size_t offset = 0, limit = SEEK2_LIMIT;
+      if (!parseSeek2Options(arg, offset, limit))
+        out << "Erro: opções inválidas: " << arg << std::endl;
+      else
+        status = seek2Query(idx2, &text, store, arg, out, offset, limit);
+    } else {
+      out << "Erro: comando desconhecido: " << command << std::endl;
+    }
+
+    // Contadores desta requisição, que a ferramenta cliente imprime.
+    IoCounters counters = ioStats().thread();
+
+    if (command != "stats") {
+      auto t1 = std::chrono::steady_clock::now();
+      stats.add(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+    }
+
+    std::string payload = out.str();
+    return std::to_string(status) + " " + formatCounters(counters) + " " + std::to_string(payload.size()) + "\n" +
+           payload;
+  }
+};
+
+// Threads de trabalho: recebem linhas de requisição do laço de poll e
+// devolvem as respostas numa fila, avisando pelo eventfd wakeFd.
+class WorkerPool {
+public:
+  struct Job {
+    uint64_t connection;
+    std::string text;
+  };
+
+private:
+  Server& server;
+  int wakeFd;
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<Job> requests;
+  std::deque<Job> responses;
+  bool closing;
+  std::vector<std::thread> threads;
+
+  void work() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      ready.wait(guard, [&] { return closing || !requests.empty(); });
+      if (requests.empty())
+        return;
+      Job job = std::move(requests.front());
+      requests.pop_front();
+      guard.unlock();
+
+      job.text = server.handle(job.text);
+      uint64_t one = 1;
+      guard.lock();
+      responses.push_back(std::move(job));
+      if (write(wakeFd, &one, sizeof(one)) < 0)
+        std::cerr << "Erro: não foi possível acordar o laço de poll" << std::endl;
+    }
+  }
+
+public:
+  // SIGINT e SIGTERM ficam bloqueados nas threads de trabalho para que
+  // interrompam o poll da thread principal.
+  WorkerPool(Server& server, int wakeFd, int count) : server(server), wakeFd(wakeFd), closing(false) {
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    for (int i = 0; i < count; i++)
+      threads.emplace_back(&WorkerPool::work, this);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  }
+
+  // Termina as requisições já recebidas e espera as threads.
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      closing = true;
+    }
+    ready.notify_all();
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  void submit(uint64_t connection, std::string request) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      requests.push_back({connection, std::move(request)});
+    }
+    ready.notify_one();
+  }
+
+  std::deque<Job> takeResponses() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::deque<Job> done;
+    done.swap(responses);
+    return done;
+  }
+};
+
+// Conexão de um cliente, manipulada só pelo laço de poll. Cada conexão tem
+// no máximo uma requisição com as threads de trabalho por vez, e a próxima
+// só segue depois de a resposta anterior ser toda enviada, então as
+// respostas saem na ordem dos pedidos e um cliente lento só atrasa a si
+// mesmo. Com uma linha à espera o socket deixa de ser lido.
+struct Connection {
+  int fd = -1;
+  std::string input;
+  std::deque<std::string> lines;
+  std::string output;
+  bool busy = false;
+  bool eof = false;
+
+  // Lê o que chegou e separa as linhas completas; false em erro.
+  bool receive() {
+    char chunk[4096];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0)
+      return errno == EAGAIN || errno == EINTR;
+    if (n == 0) {
+      eof = true;
+      return true;
+    }
+
+    input.append(chunk, n);
+    size_t eol;
+    while ((eol = input.find('\n')) != std::string::npos) {
+      lines.push_back(input.substr(0, eol));
+      input.erase(0, eol + 1);
+    }
+    return true;
+  }
+
+  // Envia o quanto o socket aceitar da resposta pendente; false em erro.
+  bool send() {
+    ssize_t n = write(fd, output.data(), output.size());
+    if (n < 0)
+      return errno == EAGAIN || errno == EINTR;
+    output.erase(0, n);
+    return true;
+  }
+
+  bool finished() const {
+    return eof && !busy && lines.empty() && output.empty();
+  }
+};
+
+int listenOn(const std::string& path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char* argv[]) {
+  size_t cacheBytes = CACHE_BYTES;
+  std::string socketPath = BD1D_SOCKET;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  bool usage = false;
+
+  for (int i = 1; i < argc && !usage; i++) {
+    std::string arg = argv[i];
+    if (arg == "--cache" && i + 1 < argc) {
+      try {
+        cacheBytes = parseSize(argv[++i]);
+      } catch (const std::exception& e) {
+        std::cerr << "Erro: tamanho de cache inválido: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "-j" && i + 1 < argc) {
+      try {
+        threads = std::stoi(argv[++i]);
+        if (threads < 1)
+          throw std::exception();
+      } catch (const std::exception& e) {
+        std::cerr << "Erro: número de threads inválido: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg[0] != '-' && i == argc - 1) {
+      socketPath = arg;
+    } else {
+      usage = true;
+    }
+  }
+
+  if (usage) {
+    std::cerr << "Uso: " << argv[0] << " [--cache <tamanho>] [-j <threads>] [socket]" << std::endl;
+    return 1;
+  }
+
+  std::cout << "=== bd1d " << socketPath << " ===" << std::endl;
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  Server server;
+  if (!server.open("data/db/hash.bin", "data/db/idx1.bin", "data/db/idx2.bin", "data/db/text.bin", cacheBytes))
+    return 1;
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0);
+
+  std::cout << " [" << t.count() << " ms] " << server.recordCount() << " registros, " << server.cachedPages()
+            << " páginas de índice em cache" << std::endl;
+
+  int listener = listenOn(socketPath);
+  int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (listener < 0 || wakeFd < 0 || fcntl(listener, F_SETFL, O_NONBLOCK) < 0) {
+    std::cerr << "Erro: não foi possível escutar em " << socketPath << std::endl;
+    return 1;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  std::cout << "aguardando consultas (" << threads << " threads)..." << std::endl;
+
+  // O laço de poll só aceita conexões, lê requisições e envia respostas;
+  // as consultas rodam nas threads do pool.
+  std::map<uint64_t, Connection> connections;
+  uint64_t nextConnection = 0;
+  {
+    WorkerPool pool(server, wakeFd, threads);
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> owners;
+
+    while (!stopping) {
+      fds = {{listener, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+      owners.clear();
+      for (auto& [id, conn] : connections) {
+        short events = (conn.eof || !conn.lines.empty() ? 0 : POLLIN) | (conn.output.empty() ? 0 : POLLOUT);
+        if (events) {
+          fds.push_back({conn.fd, events, 0});
+          owners.push_back(id);
+        }
+      }
+
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+
+      if (fds[1].revents & POLLIN) {
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+          break;
+        for (auto& done : pool.takeResponses()) {
+          auto it = connections.find(done.connection);
+          if (it == connections.end())
+            continue;
+          it->second.output = std::move(done.text);
+          it->second.busy = false;
+        }
+      }
+
+      if (fds[0].revents & POLLIN) {
+        int client;
+        while ((client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+          connections[nextConnection++].fd = client;
+      }
+
+      // Um cliente que desligou sem mandar nada a ser lido não recebe mais
+      // respostas.
+      for (size_t i = 2; i < fds.size(); i++) {
+        auto it = connections.find(owners[i - 2]);
+        Connection& conn = it->second;
+        bool ok = true;
+        if (fds[i].revents & POLLIN)
+          ok = conn.receive();
+        else if (fds[i].revents & (POLLHUP | POLLERR))
+          ok = false;
+        if (ok && (fds[i].revents & POLLOUT))
+          ok = conn.send();
+        if (!ok) {
+          close(conn.fd);
+          connections.erase(it);
+        }
+      }
+
+      // Envia as respostas recém-chegadas, despacha a próxima linha das
+      // conexões livres e fecha as que terminaram.
+      for (auto it = connections.begin(); it != connections.end();) {
+        Connection& conn = it->second;
+        bool ok = conn.output.empty() || conn.send();
+        if (ok && !conn.busy && conn.output.empty() && !conn.lines.empty()) {
+          pool.submit(it->first, std::move(conn.lines.front()));
+          conn.lines.pop_front();
+          conn.busy = true;
+        }
+        if (!ok || conn.finished()) {
+          close(conn.fd);
+          it = connections.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  for (auto& [id, conn] : connections)
+    close(conn.fd);
+  close(wakeFd);
+  close(listener);
+  unlink(socketPath.c_str());
+
+  std::cout << "bd1d encerrado" << std::endl;
+  return 0;
+}
@@ -1,9 +1,93 @@
+#include "bd1d.h"
+#include "iostats.h"
+#include "query.h"
+#include "record.h"
+#include "recordstore.h"
 #include <bits/stdc++.h>
-#include <record.h>
+
+// Lê os ids de path (separados por espaço ou quebra de linha) e imprime os
+// registros na ordem do arquivo, buscando MULTIGET_BATCH ids por vez com
+// RecordStore::multiGet. Cada lote é impresso assim que termina, para que a
+// memória não cresça com o número de ids; o resumo vem no fim.
+int findBatch(const std::string& hash_path, const std::string& path) {
+  std::ifstream input(path);
+  if (!input) {
+    std::cerr << "Erro: não foi possível abrir " << path << std::endl;
+    return 1;
+  }
+
+  std::vector<int> ids;
+  std::string token;
+  while (input >> token) {
+    try {
+      int id = std::stoi(token);
+      if (id < 1)
+        throw std::exception();
+      ids.push_back(id);
+    } catch (const std::exception& e) {
+      std::cerr << "Erro: id inválido: " << token << std::endl;
+      return 1;
+    }
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
+
+  RecordStore store;
+  if (!store.open(hash_path, RecordStore::RANDOM)) {
+    std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
+    return 1;
+  }
+  open.stop();
+
+  std::ostream& out = std::cout;
+  size_t missing = 0;
+  BatchStats total = {};
+  std::vector<Record> records;
+  std::vector<bool> found;
+  for (size_t first = 0; first < ids.size(); first += MULTIGET_BATCH) {
+    size_t count = std::min<size_t>(MULTIGET_BATCH, ids.size() - first);
+    PhaseTimer fetch(PHASE_FETCH);
+    BatchStats batch = store.multiGet(ids.data() + first, count, records, found);
+    fetch.stop();
+    total.pages += batch.pages;
+    total.reads += batch.reads;
+    total.bytes += batch.bytes;
+
+    PhaseTimer print(PHASE_PRINT);
+    for (size_t i = 0; i < count; i++) {
+      out << std::endl;
+      if (found[i]) {
+        records[i].print(out);
+      } else {
+        out << "registro " << ids[first + i] << " não encontrado" << std::endl;
+        missing++;
+      }
+    }
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+  std::cout << std::endl
+            << " " << total.pages << " páginas do hash.bin em " << total.reads << " leituras (" << total.bytes
+            << " bytes)" << std::endl;
+  printIoSummary(std::cout, "findrec", t.count(), false);
+
+  return missing ? 1 : 0;
+}
 
 int main(int argc, char* argv[]) {
+  std::string hash_path = "data/db/hash.bin";
+
+  if (argc == 3 && std::string(argv[1]) == "--ids-from") {
+    std::cout << "=== findrec --ids-from " << argv[2] << " ===" << std::endl;
+    std::cout << "Buscando em " << hash_path << std::endl;
+    return findBatch(hash_path, argv[2]);
+  }
+
   if (argc != 2) {
-    std::cerr << "Uso: " << argv[0] << " <id>" << std::endl;
+    std::cerr << "Uso: " << argv[0] << " <id> | --ids-from <arquivo>" << std::endl;
     return 1;
   }
 
@@ -17,38 +101,31 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  std::string hash_path = "data/db/hash.bin";
-
   std::cout << "=== findrec " << id << " ===" << std::endl;
   std::cout << "Buscando em " << hash_path << std::endl;
 
-  auto t0 = std::chrono::high_resolution_clock::now();
+  if (const char* socketPath = getenv("BD1_SOCKET"))
+    return runRemote(socketPath, "findrec", "findrec " + std::to_string(id), false);
+
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
 
-  std::ifstream in(hash_path, std::ios::binary);
+  RecordStore store;
 
-  if (!in) {
+  if (!store.open(hash_path, RecordStore::RANDOM, getenv("BD1_WARM") != nullptr)) {
     std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
     return 1;
   }
+  open.stop();
 
-  long offset = (id % MAP_SIZE) * sizeof(Record) * 2;
-  in.seekg(offset, std::ios::beg);
+  std::ostringstream out;
+  int status = findrecQuery(store, id, out);
 
-  Record rec;
-  for (int tries = 0; rec.id != id && tries < 2; tries++)
-    in.read(reinterpret_cast<char*>(&rec), sizeof(Record));
-
-  in.close();
-
-  auto t1 = std::chrono::high_resolution_clock::now();
+  auto t1 = std::chrono::steady_clock::now();
   auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
 
-  std::cout << " [" << t.count() << " µs]" << " 1 bloco lido" << std::endl;
-
-  if (rec.id == id)
-    rec.print();
-  else
-    std::cout << "registro não encontrado" << std::endl;
+  printIoSummary(std::cout, "findrec", t.count(), false);
+  std::cout << out.str();
 
-  return rec.id != id;
+  return status;
 }
@@ -0,0 +1,307 @@
+#include "columns.h"
+#include "iostats.h"
+#include "record.h"
+#include "scankernels.h"
+#include "textindex.h"
+#include <bits/stdc++.h>
+
+#define SCAN_CHUNK_ROWS 65536
+#define SCAN_LIMIT 100
+
+// Filtros (combinados com E) e agregação de uma varredura.
+struct ScanRequest {
+  int32_t yearFrom = INT32_MIN;
+  int32_t yearTo = INT32_MAX;
+  int32_t citesFrom = INT32_MIN;
+  int64_t updatedFrom = INT64_MIN;
+  int64_t updatedTo = INT64_MAX;
+  std::string title;
+  std::string author;
+
+  bool cites = false;
+  bool byYear = false;
+  bool ids = false;
+  size_t limit = SCAN_LIMIT;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+
+  bool byYearFilter() const {
+    return yearFrom != INT32_MIN || yearTo != INT32_MAX;
+  }
+
+  bool byCitesFilter() const {
+    return citesFrom != INT32_MIN;
+  }
+
+  bool byUpdated() const {
+    return updatedFrom != INT64_MIN || updatedTo != INT64_MAX;
+  }
+};
+
+// Resultado parcial de uma thread.
+struct ScanPartial {
+  IntAggregate cites;
+  std::vector<int64_t> yearCount;
+  std::vector<int64_t> yearCites;
+};
+
+bool parseArgs(int argc, char* argv[], ScanRequest& request) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--count") {
+      continue;
+    } else if (arg == "--cites") {
+      request.cites = true;
+      continue;
+    } else if (arg == "--by-year") {
+      request.byYear = true;
+      continue;
+    } else if (arg == "--ids") {
+      request.ids = true;
+      continue;
+    }
+
+    if (i + 1 >= argc)
+      return false;
+    std::string value = argv[++i];
+    if (arg == "--title") {
+      request.title = value;
+    } else if (arg == "--author") {
+      request.author = value;
+    } else if (arg == "--updated-from" || arg == "--updated-to") {
+      time_t t = 0;
+      if (!parseDateTime(value, t))
+        return false;
+      (arg == "--updated-from" ? request.updatedFrom : request.updatedTo) = t;
+    } else {
+      long long number = 0;
+      try {
+        size_t used = 0;
+        number = std::stoll(value, &used);
+        if (used != value.size() || number <= INT32_MIN || number >= INT32_MAX)
+          return false;
+      } catch (const std::exception& e) {
+        return false;
+      }
+
+      if (arg == "--year")
+        request.yearFrom = request.yearTo = number;
+      else if (arg == "--from-year")
+        request.yearFrom = number;
+      else if (arg == "--to-year")
+        request.yearTo = number;
+      else if (arg == "--cites-above")
+        request.citesFrom = number + 1;
+      else if (arg == "--limit" && number > 0)
+        request.limit = number;
+      else if (arg == "-j" && number > 0)
+        request.threads = number;
+      else
+        return false;
+    }
+  }
+  return request.yearFrom <= request.yearTo && request.updatedFrom <= request.updatedTo &&
+         !(request.ids && (request.cites || request.byYear));
+}
+
+int main(int argc, char* argv[]) {
+  ScanRequest request;
+  if (!parseArgs(argc, argv, request)) {
+    std::cerr << "Uso: " << argv[0]
+              << " [--year <Y> | --from-year <A> --to-year <B>] [--cites-above <C>]"
+                 " [--updated-from <data>] [--updated-to <data>] [--title <texto>] [--author <texto>]"
+                 " [--count | --cites | --by-year [--cites] | --ids [--limit <N>]] [-j <threads>]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string args;
+  for (int i = 1; i < argc; i++)
+    args += std::string(" ") + argv[i];
+  std::cout << "=== scan" << args << " ===" << std::endl;
+
+  std::string prefix = "data/db/col_";
+  bool populate = getenv("BD1_WARM") != nullptr;
+  bool useYear = request.byYearFilter() || request.byYear;
+  bool useCites = request.byCitesFilter() || request.cites;
+  bool useUpdated = request.byUpdated();
+
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
+
+  // Só as colunas citadas na consulta são abertas; col_id.bin sempre, mas
+  // fora do --ids só o seu cabeçalho (com o número de linhas) é lido.
+  Column ids, years, cites, updated;
+  TextColumn titles, authors;
+  std::vector<std::string> used;
+  auto openColumn = [&](bool use, auto& column, const std::string& name, auto... type) {
+    if (!use)
+      return true;
+    if (!column.open(prefix + name, type..., populate)) {
+      std::cerr << "Erro: não foi possível abrir a coluna " << prefix + name << std::endl;
+      return false;
+    }
+    used.push_back(name);
+    return true;
+  };
+  if (!openColumn(true, ids, "id.bin", COLUMN_INT32) || !openColumn(useYear, years, "year.bin", COLUMN_INT32) ||
+      !openColumn(useCites, cites, "cites.bin", COLUMN_INT32) ||
+      !openColumn(useUpdated, updated, "datetime.bin", COLUMN_INT64) ||
+      !openColumn(!request.title.empty(), titles, "title") || !openColumn(!request.author.empty(), authors, "authors"))
+    return 1;
+  open.stop();
+
+  size_t rows = ids.count();
+  for (int64_t count : {years.count(), cites.count(), updated.count(), titles.count(), authors.count()}) {
+    if (count > 0 && (size_t) count != rows) {
+      std::cerr << "Erro: colunas com números de linhas diferentes" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "Varrendo " << rows << " linhas, colunas:";
+  for (const std::string& name : used)
+    std::cout << " " << name;
+  std::cout << std::endl;
+
+  std::string titleFolded(request.title.size(), '\0');
+  std::transform(request.title.begin(), request.title.end(), titleFolded.begin(), foldByte);
+  std::string authorFolded(request.author.size(), '\0');
+  std::transform(request.author.begin(), request.author.end(), authorFolded.begin(), foldByte);
+
+  int32_t firstYear = useYear ? years.min() : 0;
+  size_t yearSlots = useYear && rows ? years.max() - years.min() + 1 : 0;
+  RangeFilter32Fn filter32 = rangeFilter32Default();
+  RangeFilter64Fn filter64 = rangeFilter64Default();
+
+  // Pedaços de SCAN_CHUNK_ROWS linhas distribuídos entre as threads sob
+  // demanda; as linhas selecionadas de cada pedaço ficam no seu mapa de bits.
+  size_t chunks = (rows + SCAN_CHUNK_ROWS - 1) / SCAN_CHUNK_ROWS;
+  int threads = std::max<int>(1, std::min<size_t>(request.threads, chunks));
+  std::atomic<size_t> nextChunk(0);
+  std::vector<ScanPartial> partials(threads);
+  std::vector<int64_t> chunkCount(chunks);
+  std::vector<std::vector<int>> chunkIds(request.ids ? chunks : 0);
+
+  auto worker = [&](ScanPartial& partial) {
+    partial.yearCount.assign(yearSlots, 0);
+    partial.yearCites.assign(request.byYear && request.cites ? yearSlots : 0, 0);
+    std::vector<uint64_t> selection;
+
+    for (size_t c; (c = nextChunk++) < chunks;) {
+      size_t first = c * SCAN_CHUNK_ROWS;
+      size_t n = std::min<size_t>(SCAN_CHUNK_ROWS, rows - first);
+      size_t words = (n + 63) / 64;
+      selectAll(n, selection);
+
+      // Filtros numéricos primeiro; os de texto só olham o que sobrou.
+      if (request.byYearFilter()) {
+        years.touch(first, n);
+        filter32(years.values<int32_t>() + first, n, request.yearFrom, request.yearTo, selection.data());
+      }
+      if (request.byCitesFilter()) {
+        cites.touch(first, n);
+        filter32(cites.values<int32_t>() + first, n, request.citesFrom, INT32_MAX, selection.data());
+      }
+      if (useUpdated) {
+        updated.touch(first, n);
+        filter64(updated.values<int64_t>() + first, n, request.updatedFrom, request.updatedTo, selection.data());
+      }
+      auto textFilter = [&](const TextColumn& column, const std::string& folded) {
+        column.touch(first, n);
+        forEachSelected(selection.data(), words, [&](size_t i) {
+          if (!containsFolded(column.at(first + i), folded))
+            selection[i / 64] &= ~(1ULL << (i % 64));
+        });
+      };
+      if (!request.title.empty())
+        textFilter(titles, titleFolded);
+      if (!request.author.empty())
+        textFilter(authors, authorFolded);
+
+      chunkCount[c] = countSelected(selection.data(), words);
+      if (request.cites && !request.byCitesFilter())
+        cites.touch(first, n);
+      if (request.byYear && !request.byYearFilter())
+        years.touch(first, n);
+
+      if (request.byYear) {
+        const int32_t* year = years.values<int32_t>() + first;
+        const int32_t* cite = request.cites ? cites.values<int32_t>() + first : nullptr;
+        forEachSelected(selection.data(), words, [&](size_t i) {
+          partial.yearCount[year[i] - firstYear]++;
+          if (cite)
+            partial.yearCites[year[i] - firstYear] += cite[i];
+        });
+      } else if (request.cites) {
+        aggregateSelected(cites.values<int32_t>() + first, selection.data(), words, partial.cites);
+      } else if (request.ids) {
+        // Nenhum pedaço contribui com mais de --limit ids para a saída.
+        ids.touch(first, n);
+        const int32_t* id = ids.values<int32_t>() + first;
+        std::vector<int>& out = chunkIds[c];
+        for (size_t w = 0; w < words && out.size() < request.limit; w++)
+          for (uint64_t bits = selection[w]; bits && out.size() < request.limit; bits &= bits - 1)
+            out.push_back(id[w * 64 + __builtin_ctzll(bits)]);
+      }
+    }
+  };
+
+  PhaseTimer scan(PHASE_FETCH);
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+    workers.emplace_back(worker, std::ref(partials[t]));
+  worker(partials[0]);
+  for (auto& w : workers)
+    w.join();
+  scan.stop();
+
+  PhaseTimer print(PHASE_PRINT);
+  std::ostringstream out;
+  int64_t total = std::accumulate(chunkCount.begin(), chunkCount.end(), (int64_t) 0);
+
+  if (request.byYear) {
+    for (size_t t = 1; t < partials.size(); t++) {
+      for (size_t y = 0; y < yearSlots; y++) {
+        partials[0].yearCount[y] += partials[t].yearCount[y];
+        if (request.cites)
+          partials[0].yearCites[y] += partials[t].yearCites[y];
+      }
+    }
+    for (size_t y = 0; y < yearSlots; y++) {
+      int64_t count = partials[0].yearCount[y];
+      if (!count)
+        continue;
+      out << firstYear + (int) y << ": " << count << (count == 1 ? " registro" : " registros");
+      if (request.cites)
+        out << ", média de citações " << std::fixed << std::setprecision(2)
+            << (double) partials[0].yearCites[y] / count;
+      out << std::endl;
+    }
+  } else if (request.cites) {
+    for (size_t t = 1; t < partials.size(); t++)
+      partials[0].cites.merge(partials[t].cites);
+    const IntAggregate& agg = partials[0].cites;
+    out << agg.count << (agg.count == 1 ? " registro" : " registros");
+    if (agg.count)
+      out << ", citações: soma " << agg.sum << ", média " << std::fixed << std::setprecision(2)
+          << (double) agg.sum / agg.count << ", mínimo " << agg.min << ", máximo " << agg.max;
+    out << std::endl;
+  } else if (request.ids) {
+    size_t printed = 0;
+    for (size_t c = 0; c < chunks && printed < request.limit; c++)
+      for (size_t i = 0; i < chunkIds[c].size() && printed < request.limit; i++, printed++)
+        out << chunkIds[c][i] << std::endl;
+    if ((int64_t) printed < total)
+      out << std::endl << "mais resultados: " << total << " no total" << std::endl;
+  } else {
+    out << total << (total == 1 ? " registro" : " registros") << std::endl;
+  }
+  print.stop();
+
+  auto t1 = std::chrono::steady_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+  printIoSummary(std::cout, "scan", t.count());
+  std::cout << out.str();
+
+  return 0;
+}
@@ -1,66 +1,77 @@
 #include "b+tree.h"
+#include "bd1d.h"
+#include "iostats.h"
+#include "query.h"
 #include "record.h"
+#include "recordstore.h"
 #include <bits/stdc++.h>
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "Uso: " << argv[0] << " <ID>" << std::endl;
-    return 1;
-  }
+  // "--from A --to B [--limit N]" pede um intervalo de ids; senão, um id só.
+  bool range = argc > 1 && argv[1][0] == '-' && argv[1][1] == '-';
+  std::string request;
+  int id = 0, from = 0, to = INT_MAX;
+  size_t limit = SEEK1_LIMIT;
+
+  if (range) {
+    for (int i = 1; i < argc; i++)
+      request += (i > 1 ? " " : "") + std::string(argv[i]);
+    if (!parseSeek1Range(request, from, to, limit)) {
+      std::cerr << "Uso: " << argv[0] << " <ID> | --from <ID> [--to <ID>] [--limit N]" << std::endl;
+      return 1;
+    }
+  } else {
+    if (argc != 2) {
+      std::cerr << "Uso: " << argv[0] << " <ID> | --from <ID> [--to <ID>] [--limit N]" << std::endl;
+      return 1;
+    }
 
-  int id;
-  try {
-    id = std::stoi(argv[1]);
-    if (id < 1)
-      throw std::exception();
-  } catch (const std::exception& e) {
-    std::cerr << "Erro: id inválido: " << argv[1] << std::endl;
-    return 1;
+    try {
+      id = std::stoi(argv[1]);
+      if (id < 1)
+        throw std::exception();
+    } catch (const std::exception& e) {
+      std::cerr << "Erro: id inválido: " << argv[1] << std::endl;
+      return 1;
+    }
+    request = std::to_string(id);
   }
 
   std::string hash_path = "data/db/hash.bin";
   std::string idx1_path = "data/db/idx1.bin";
 
-  std::cout << "=== seek1 " << id << " ===" << std::endl;
+  std::cout << "=== seek1 " << request << " ===" << std::endl;
   std::cout << "Buscando em " << idx1_path << std::endl;
 
+  if (const char* socketPath = getenv("BD1_SOCKET"))
+    return runRemote(socketPath, "seek1", "seek1 " + request);
+
   BPlusTree<int> bptree(170);
 
-  auto t0 = std::chrono::high_resolution_clock::now();
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
 
   if (!bptree.loadFromFile(idx1_path)) {
     std::cerr << "Erro: não foi possível carregar o índice primário" << std::endl;
     return 1;
   }
 
-  auto result = bptree.search(id);
+  RecordStore store;
 
-  auto t1 = std::chrono::high_resolution_clock::now();
-  auto t = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0);
-
-  std::cout << " [" << t.count() << " ms] " << bptree.getLoadedNodesCount() << " blocos lidos" << std::endl;
-
-  if (result != nullptr) {
-    std::ifstream in(hash_path, std::ios::binary);
-
-    if (!in) {
-      std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
-      return 1;
-    }
+  if (!store.open(hash_path, RecordStore::RANDOM, getenv("BD1_WARM") != nullptr)) {
+    std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
+    return 1;
+  }
+  open.stop();
 
-    long offset = (id % MAP_SIZE) * sizeof(Record) * 2;
-    in.seekg(offset, std::ios::beg);
+  std::ostringstream out;
+  int status = range ? seek1RangeQuery(bptree, store, from, to, out, limit) : seek1Query(bptree, store, id, out);
 
-    Record rec;
-    for (int tries = 0; rec.id != id && tries < 2; tries++)
-      in.read(reinterpret_cast<char*>(&rec), sizeof(Record));
+  auto t1 = std::chrono::steady_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
 
-    in.close();
+  printIoSummary(std::cout, "seek1", t.count());
+  std::cout << out.str();
 
-    rec.print();
-    return 0;
-  } else {
-    std::cout << "registro não encontrado" << std::endl;
-    return 1;
-  }
+  return status;
 }
@@ -1,65 +1,84 @@
 #include "b+tree.h"
+#include "bd1d.h"
+#include "iostats.h"
+#include "query.h"
 #include "record.h"
+#include "recordstore.h"
+#include "textindex.h"
 #include <bits/stdc++.h>
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "Uso: " << argv[0] << " \"<Título>\"" << std::endl;
+  size_t offset = 0, limit = SEEK2_LIMIT;
+  std::string titulo;
+  bool valid = argc > 1;
+
+  for (int i = 1; i < argc && valid; i++) {
+    std::string arg = argv[i];
+    if ((arg == "--offset" || arg == "--limit") && i + 2 < argc) {
+      try {
+        std::string text = argv[++i];
+        size_t used = 0;
+        long long value = std::stoll(text, &used);
+        if (used != text.size() || value < 0 || (arg == "--limit" && value == 0))
+          throw std::exception();
+        (arg == "--offset" ? offset : limit) = value;
+      } catch (const std::exception& e) {
+        std::cerr << "Erro: valor inválido para " << arg << ": " << argv[i] << std::endl;
+        return 1;
+      }
+    } else {
+      titulo = arg;
+      valid = i == argc - 1;
+    }
+  }
+
+  if (!valid) {
+    std::cerr << "Uso: " << argv[0] << " [--offset N] [--limit N] \"<Título>\"" << std::endl;
     return 1;
   }
 
-  std::string titulo = argv[1];
   std::string hash_path = "data/db/hash.bin";
   std::string idx2_path = "data/db/idx2.bin";
+  std::string text_path = "data/db/text.bin";
 
   std::cout << "=== seek2 " << titulo << " ===" << std::endl;
   std::cout << "Buscando em " << idx2_path << std::endl;
 
+  if (const char* socketPath = getenv("BD1_SOCKET")) {
+    std::replace(titulo.begin(), titulo.end(), '\n', ' ');
+    return runRemote(socketPath, "seek2",
+                     "seek2 --offset " + std::to_string(offset) + " --limit " + std::to_string(limit) + " " + titulo);
+  }
+
   BPlusTree<std::pair<std::string, int>> bptree(6);
 
-  auto t0 = std::chrono::high_resolution_clock::now();
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
 
   if (!bptree.loadFromFile(idx2_path)) {
     std::cerr << "Erro: não foi possível carregar o índice secundário" << std::endl;
     return 1;
   }
 
-  auto results = bptree.searchByPrefix(titulo);
-
-  if (results.empty())
-    results = bptree.searchBySubstring(titulo);
-
-  auto t1 = std::chrono::high_resolution_clock::now();
-  auto t = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0);
+  RecordStore store;
 
-  std::cout << " [" << t.count() << " ms] " << bptree.getLoadedNodesCount() << " blocos lidos" << std::endl;
-
-  bool found = !results.empty();
+  if (!store.open(hash_path, RecordStore::RANDOM, getenv("BD1_WARM") != nullptr)) {
+    std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
+    return 1;
+  }
 
-  if (found) {
-    std::ifstream in(hash_path, std::ios::binary);
+  TextIndex text;
+  text.open(text_path);
+  open.stop();
 
-    if (!in) {
-      std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
-      return 1;
-    }
+  std::ostringstream out;
+  int status = seek2Query(bptree, &text, store, titulo, out, offset, limit);
 
-    for (size_t i = 0; i < results.size(); i++) {
-      int id = results[i].second;
-      long offset = (id % MAP_SIZE) * sizeof(Record) * 2;
-      in.seekg(offset, std::ios::beg);
+  auto t1 = std::chrono::steady_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
 
-      Record rec;
-      for (int tries = 0; rec.id != id && tries < 2; tries++)
-        in.read(reinterpret_cast<char*>(&rec), sizeof(Record));
+  printIoSummary(std::cout, "seek2", t.count());
+  std::cout << out.str();
 
-      std::cout << std::endl;
-      rec.print();
-    }
-    in.close();
-    return 0;
-  } else {
-    std::cout << "nenhum registro encontrado" << std::endl;
-    return 1;
-  }
+  return status;
 }
@@ -0,0 +1,71 @@
+#include "b+tree.h"
+#include "iostats.h"
+#include "query.h"
+#include "record.h"
+#include "recordstore.h"
+#include "secondary.h"
+#include <bits/stdc++.h>
+
+int main(int argc, char* argv[]) {
+  std::string request;
+  for (int i = 1; i < argc; i++)
+    request += (i > 1 ? " " : "") + std::string(argv[i]);
+
+  Seek3Request query;
+  if (!parseSeek3Options(request, query)) {
+    std::cerr << "Uso: " << argv[0]
+              << " [--year <Y> | --from-year <A> --to-year <B>] [--cites-above <C>] [--top <N>]"
+                 " [--count | --ids] [--limit <N>]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string hash_path = "data/db/hash.bin";
+  std::string year_path = "data/db/idx_year.bin";
+  std::string cites_path = "data/db/idx_cites.bin";
+
+  bool useYears = query.byYear();
+  bool useCites = query.byCites() || query.top;
+
+  std::cout << "=== seek3 " << request << " ===" << std::endl;
+  std::cout << "Buscando em";
+  if (useYears)
+    std::cout << " " << year_path;
+  if (useCites)
+    std::cout << " " << cites_path;
+  std::cout << std::endl;
+
+  SecondaryIndex years(170);
+  SecondaryIndex cites(170);
+
+  auto t0 = std::chrono::steady_clock::now();
+  PhaseTimer open(PHASE_OPEN);
+
+  if (useYears && !years.loadFromFile(year_path)) {
+    std::cerr << "Erro: não foi possível carregar o índice de anos" << std::endl;
+    return 1;
+  }
+  if (useCites && !cites.loadFromFile(cites_path)) {
+    std::cerr << "Erro: não foi possível carregar o índice de citações" << std::endl;
+    return 1;
+  }
+
+  // Contagens e listas de ids não abrem o hash.bin.
+  RecordStore store;
+  if (query.needsRecords() && !store.open(hash_path, RecordStore::RANDOM, getenv("BD1_WARM") != nullptr)) {
+    std::cerr << "Erro: não foi possível abrir " << hash_path << std::endl;
+    return 1;
+  }
+  open.stop();
+
+  std::ostringstream out;
+  int status = seek3Query(&years, &cites, &store, query, out);
+
+  auto t1 = std::chrono::steady_clock::now();
+  auto t = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+  printIoSummary(std::cout, "seek3", t.count());
+  std::cout << out.str();
+
+  return status;
+}
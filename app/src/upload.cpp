@@ -1,54 +1,186 @@
 #include "b+tree.h"
+#include "columns.h"
+#include "csv.h"
+#include "extsort.h"
+#include "hashfile.h"
 #include "record.h"
+#include "secondary.h"
+#include "textindex.h"
 #include <bits/stdc++.h>
+#include <malloc.h>
+#include <sys/resource.h>
 
-std::string trim(std::string& field) {
-  std::string trimmed = field;
-  trimmed.erase(trimmed.begin(), find_if(trimmed.begin(), trimmed.end(), [](char c) { return !isspace(c); }));
-  trimmed.erase(find_if(trimmed.rbegin(), trimmed.rend(), [](char c) { return !isspace(c); })
-                    .base(),
-                trimmed.end());
-  return trimmed;
+#define SORT_MEM_LIMIT (512L << 20)
+#define INDEX_FILL_FACTOR 1.0
+#define CHUNK_SIZE (8L << 20)
+#define MIN_CHUNK_SIZE (64L << 10)
+#define MIN_MEM_BUDGET (16L << 20)
+#define MMAP_THRESHOLD (128 << 10)
+
+struct ParsedChunk {
+  size_t textBytes = 0;
+  std::vector<Record> records;
+  std::vector<std::string> titles;
+  std::vector<std::vector<uint32_t>> trigrams;
+
+  // Memória dos registros, títulos e trigramas do pedaço.
+  size_t memoryBytes() const {
+    size_t bytes = records.capacity() * sizeof(Record) + titles.capacity() * sizeof(std::string) +
+                   trigrams.capacity() * sizeof(std::vector<uint32_t>);
+    for (const auto& title : titles)
+      bytes += title.capacity() + 1;
+    for (const auto& terms : trigrams)
+      bytes += terms.capacity() * sizeof(uint32_t);
+    return bytes;
+  }
+};
+
+ParsedChunk parseChunk(std::string text) {
+  ParsedChunk chunk;
+  CsvTokenizer tokenizer;
+
+  size_t lines = std::count(text.begin(), text.end(), '\n') + 1;
+  chunk.textBytes = text.size();
+  chunk.records.reserve(lines);
+  chunk.titles.reserve(lines);
+  chunk.trigrams.reserve(lines);
+
+  tokenizer.tokenize(&text[0], text.size(), true, [&](const CsvRow& row) {
+    std::string_view fields[7];
+    for (int i = 0; i < 7 && i < row.count; i++)
+      fields[i] = row.fields[i];
+
+    chunk.records.emplace_back(fields);
+    chunk.titles.emplace_back(fields[1]);
+    chunk.trigrams.push_back(recordTrigrams(chunk.records.back()));
+  });
+  return chunk;
 }
 
-std::vector<std::string> parse(std::string& line) {
-  std::vector<std::string> fields;
-  std::string field;
-  bool inQuotes = false;
-
-  for (char c : line) {
-    if (c == '"') {
-      inQuotes = !inQuotes;
-    } else if (c == ';' && !inQuotes) {
-      fields.push_back(trim(field));
-      field.clear();
-    } else {
-      field += c;
-    }
+// Lê o próximo pedaço do CSV cortado no último '\n'. É o mesmo limite de
+// registro do CsvTokenizer, que só trata aspas dentro de uma linha, então um
+// corte em '\n' nunca separa um campo entre aspas. Devolve false no fim.
+bool readChunk(std::ifstream& in, size_t chunkSize, std::string& carry, std::string& text) {
+  text.swap(carry);
+  carry.clear();
+
+  size_t old = text.size();
+  text.resize(old + chunkSize);
+  in.read(&text[old], chunkSize);
+  text.resize(old + in.gcount());
+
+  if (!in)
+    return false;
+
+  size_t cut = text.rfind('\n');
+  if (cut == std::string::npos) {
+    carry.swap(text);
+  } else {
+    carry = text.substr(cut + 1);
+    text.resize(cut + 1);
   }
+  return true;
+}
+
+size_t peakRssBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (size_t) usage.ru_maxrss << 10;
+}
 
-  fields.push_back(trim(field));
-  return fields;
+long peakRssMB() {
+  return peakRssBytes() >> 20;
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "Uso: " << argv[0] << " <arquivo_csv>" << std::endl;
+  size_t memLimit = 0;
+  int threads = 1;
+  bool compress = false;
+  std::string csv_path;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--mem-limit" && i + 1 < argc) {
+      try {
+        memLimit = parseSize(argv[++i]);
+      } catch (const std::exception& e) {
+        std::cerr << "Erro: limite de memória inválido: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "-j" && i + 1 < argc) {
+      try {
+        threads = std::stoi(argv[++i]);
+        if (threads < 1)
+          throw std::exception();
+      } catch (const std::exception& e) {
+        std::cerr << "Erro: número de threads inválido: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--compress") {
+      compress = true;
+    } else if (csv_path.empty() && arg[0] != '-') {
+      csv_path = arg;
+    } else {
+      csv_path.clear();
+      break;
+    }
+  }
+
+  if (csv_path.empty()) {
+    std::cerr << "Uso: " << argv[0] << " [-j <threads>] [--mem-limit <tamanho>] [--compress] <arquivo_csv>"
+              << std::endl;
     return 1;
   }
 
   system("rm -rf data/db");
   system("mkdir data/db");
 
-  std::string csv_path = argv[1];
   std::string hash_path = "data/db/hash.bin";
   std::string idx1_path = "data/db/idx1.bin";
   std::string idx2_path = "data/db/idx2.bin";
+  std::string text_path = "data/db/text.bin";
+  std::string year_path = "data/db/idx_year.bin";
+  std::string cites_path = "data/db/idx_cites.bin";
+  std::string columns_prefix = "data/db/col_";
+
+  // Partilha do --mem-limit: primeiro saem o RSS do processo ao iniciar, os
+  // buffers das colunas e o mapa de trigramas de cada thread de análise. Do
+  // resto, 1/4 vai para o hash.bin, 1/4 para o text.bin (metade para as
+  // chaves, metade para o buffer auxiliar do radix sort), 1/8 para o idx2,
+  // 1/16 para o idx1, 1/32 para cada índice secundário e 3/16 para os
+  // pedaços do CSV em análise (texto e registros); o 1/16 que sobra cobre
+  // os buffers de escrita dos arquivos.
+  size_t budget = 0;
+  if (memLimit) {
+    size_t fixed = peakRssBytes() + ColumnSetWriter::bufferBytes() + threads * TRIGRAM_SEEN_WORDS * sizeof(uint64_t);
+    if (memLimit < fixed + MIN_MEM_BUDGET) {
+      std::cerr << "Erro: limite de memória abaixo do mínimo de " << ((fixed + MIN_MEM_BUDGET) >> 20) << " MB com "
+                << threads << " threads" << std::endl;
+      return 1;
+    }
+    budget = memLimit - fixed;
+
+    // Com o limiar fixo, blocos grandes (buffers dos sorters, pedaços, runs)
+    // sempre vêm de mmap e voltam ao sistema no free; o limiar dinâmico da
+    // glibc passaria a servi-los do heap, onde a memória liberada continua
+    // contando no RSS.
+    mallopt(M_MMAP_THRESHOLD, MMAP_THRESHOLD);
+  }
 
   int processed = 0;
-  std::vector<std::vector<Record>> hashmap(MAP_SIZE);
-  BPlusTree<int> bptIdx1(170);
-  BPlusTree<std::pair<std::string, int>> bptIdx2(6);
+  HashFileBuilder records("data/db/hash", budget ? budget / 4 : SIZE_MAX, compress);
+  ExternalSorter<int> idx1Keys("data/db/idx1", budget ? budget / 16 : SORT_MEM_LIMIT);
+  ExternalSorter<std::pair<std::string, int>> idx2Keys("data/db/idx2", budget ? budget / 8 : SORT_MEM_LIMIT);
+  ExternalSorter<uint64_t> textKeys("data/db/text", budget ? budget / 8 : SORT_MEM_LIMIT);
+  ExternalSorter<std::pair<int, int>> yearKeys("data/db/idx_year", budget ? budget / 32 : SORT_MEM_LIMIT);
+  ExternalSorter<std::pair<int, int>> citesKeys("data/db/idx_cites", budget ? budget / 32 : SORT_MEM_LIMIT);
+
+  // As colunas são gravadas à medida que os registros chegam, na ordem do CSV.
+  ColumnSetWriter columns;
+  if (!columns.open(columns_prefix)) {
+    std::cerr << "Erro: não foi possível criar as colunas " << columns_prefix << "*" << std::endl;
+    return 1;
+  }
 
   std::ifstream csv_file(csv_path);
   if (!csv_file) {
@@ -60,71 +192,125 @@ int main(int argc, char* argv[]) {
 
   auto t0 = std::chrono::high_resolution_clock::now();
 
-  for (std::string line; getline(csv_file, line); processed++) {
-    std::vector<std::string> fields = parse(line);
-    Record art(fields);
-    hashmap[art.id % MAP_SIZE].push_back(art);
-    bptIdx1.insert(art.id);
-    bptIdx2.insert({fields[1], art.id});
-
-    if (processed % 100000 == 0 && processed > 0) {
-      auto tx = std::chrono::high_resolution_clock::now();
-      auto t = std::chrono::duration_cast<std::chrono::seconds>(tx - t0);
-      std::cout << " [" << t.count() << "s] " << processed << " registros processados" << std::endl;
-    }
-  }
-  csv_file.close();
+  // Ficam em memória ao mesmo tempo o pedaço sendo consumido, até threads - 1
+  // em análise (cada um com o texto e os registros) e o texto do próximo.
+  // Com limite, o tamanho dos pedaços segue a maior razão já medida entre a
+  // memória de um pedaço analisado e o seu texto; até a primeira medida eles
+  // têm o tamanho mínimo.
+  size_t chunkSize = budget ? MIN_CHUNK_SIZE : CHUNK_SIZE;
+  double expansion = 0;
 
-  std::cout << "populando " << hash_path << "..." << std::endl;
+  auto consume = [&](ParsedChunk chunk) {
+    if (budget && chunk.textBytes > 0) {
+      expansion = std::max(expansion, (double) chunk.memoryBytes() / chunk.textBytes);
+      size_t fit = budget / 16 * 3 / (threads * (expansion + 1) + 1);
+      chunkSize = std::max<size_t>(MIN_CHUNK_SIZE, std::min<size_t>(CHUNK_SIZE, fit));
+    }
 
-  std::ofstream out(hash_path, std::ios::binary);
+    for (size_t i = 0; i < chunk.records.size(); i++, processed++) {
+      const Record& art = chunk.records[i];
+      records.add(art);
+      columns.add(art);
+      idx1Keys.add(art.id);
+      idx2Keys.add({std::move(chunk.titles[i]), art.id});
+      for (uint32_t term : chunk.trigrams[i])
+        textKeys.add((uint64_t) term << 32 | (uint32_t) art.id);
+      yearKeys.add(yearKey(art.year, art.id));
+      citesKeys.add(citesKey(art.cites, art.id));
 
-  if (!out) {
-    std::cerr << "erro: não foi possível criar " << hash_path << std::endl;
-    return 1;
-  }
+      if (processed % 100000 == 0 && processed > 0) {
+        auto tx = std::chrono::high_resolution_clock::now();
+        auto t = std::chrono::duration_cast<std::chrono::seconds>(tx - t0);
+        std::cout << " [" << t.count() << "s] " << processed << " registros processados, pico RSS " << peakRssMB()
+                  << " MB" << std::endl;
+      }
+    }
+  };
 
-  for (auto& bucket : hashmap) {
-    int count = 0;
+  std::deque<std::future<ParsedChunk>> pending;
+  std::string carry;
+  for (bool more = true; more;) {
+    std::string text;
+    more = readChunk(csv_file, chunkSize, carry, text);
+    if (text.empty())
+      continue;
 
-    for (const Record& record : bucket) {
-      out.write(reinterpret_cast<const char*>(&record), sizeof(Record));
-      count++;
+    if (threads == 1) {
+      consume(parseChunk(std::move(text)));
+      continue;
     }
 
-    for (; count < 2; count++)
-      out.write(std::string(sizeof(Record), '\0').c_str(), sizeof(Record));
+    pending.push_back(std::async(std::launch::async, parseChunk, std::move(text)));
+    if ((int) pending.size() >= threads) {
+      consume(pending.front().get());
+      pending.pop_front();
+    }
   }
+  for (; !pending.empty(); pending.pop_front())
+    consume(pending.front().get());
+  csv_file.close();
 
-  long file_size = out.tellp();
-  out.close();
+  auto policy = threads > 1 ? std::launch::async : std::launch::deferred;
 
-  auto tx = std::chrono::high_resolution_clock::now();
-  auto t = std::chrono::duration_cast<std::chrono::seconds>(tx - t0);
+  BPlusTree<int> bptIdx1(170);
+  BPlusTree<std::pair<std::string, int>> bptIdx2(6);
+  SecondaryIndex bptYear(170);
+  SecondaryIndex bptCites(170);
 
-  int num_blocks = (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  auto hashTask = std::async(policy, [&] { return records.write(hash_path, threads); });
+  auto idx1Task = std::async(policy, [&] {
+    idx1Keys.sort();
+    return bptIdx1.bulkLoadToFile(idx1_path, idx1Keys.begin(), idx1Keys.end(), INDEX_FILL_FACTOR);
+  });
+  auto idx2Task = std::async(policy, [&] {
+    idx2Keys.sort();
+    return bptIdx2.bulkLoadToFile(idx2_path, idx2Keys.begin(), idx2Keys.end(), INDEX_FILL_FACTOR);
+  });
 
-  std::cout << " [" << t.count() << "s] " << num_blocks << " blocos escritos" << std::endl;
+  auto yearTask = std::async(policy, [&] {
+    yearKeys.sort();
+    return bptYear.bulkLoadToFile(year_path, yearKeys.begin(), yearKeys.end(), INDEX_FILL_FACTOR);
+  });
+  auto citesTask = std::async(policy, [&] {
+    citesKeys.sort();
+    return bptCites.bulkLoadToFile(cites_path, citesKeys.begin(), citesKeys.end(), INDEX_FILL_FACTOR);
+  });
 
-  std::cout << "populando " << idx1_path << "..." << std::endl;
+  auto textTask = std::async(policy, [&] {
+    textKeys.sort();
+    TextIndexWriter writer;
+    if (!writer.open(text_path, processed))
+      return -1;
+    for (uint64_t posting : textKeys)
+      writer.add(posting);
+    return writer.close();
+  });
 
-  int numBlocks = bptIdx1.saveToFile(idx1_path);
-  if (numBlocks == -1) {
-    std::cerr << "Erro: não foi possível salvar índice primário" << std::endl;
-  } else {
+  // "populando X..." e, quando finish() termina, o tempo desde o início e os
+  // blocos escritos, ou a mensagem de erro se ele devolver -1.
+  auto report = [&](const std::string& path, const std::string& error, auto finish) {
+    std::cout << "populando " << path << "..." << std::endl;
+    int numBlocks = finish();
+    if (numBlocks == -1) {
+      std::cerr << error << std::endl;
+      return false;
+    }
     auto t1 = std::chrono::high_resolution_clock::now();
     auto loading_time = std::chrono::duration_cast<std::chrono::seconds>(t1 - t0);
-    std::cout << " [" << loading_time.count() << "s]" << numBlocks << " blocos escritos" << std::endl;
-  }
+    std::cout << " [" << loading_time.count() << "s] " << numBlocks << " blocos escritos" << std::endl;
+    return true;
+  };
 
-  numBlocks = bptIdx2.saveToFile(idx2_path);
-  if (numBlocks == -1) {
-    std::cerr << "Erro: não foi possível salvar índice secundário" << std::endl;
-  } else {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    auto loading_time = std::chrono::duration_cast<std::chrono::seconds>(t1 - t0);
-    std::cout << " [" << loading_time.count() << "s]" << numBlocks << " blocos escritos" << std::endl;
-  }
+  if (!report(hash_path, "erro: não foi possível gravar " + hash_path, [&] { return hashTask.get(); }))
+    return 1;
+  report(idx1_path, "Erro: não foi possível salvar índice primário", [&] { return idx1Task.get(); });
+  report(idx2_path, "Erro: não foi possível salvar índice secundário", [&] { return idx2Task.get(); });
+  report(year_path, "Erro: não foi possível salvar índice de anos", [&] { return yearTask.get(); });
+  report(cites_path, "Erro: não foi possível salvar índice de citações", [&] { return citesTask.get(); });
+  report(columns_prefix + "*", "Erro: não foi possível salvar as colunas", [&] { return columns.close(); });
+  report(text_path, "Erro: não foi possível salvar índice de texto", [&] { return textTask.get(); });
+
+  std::cout << "pico RSS " << peakRssMB() << " MB" << std::endl;
 
   return 0;
 }